@@ -0,0 +1,214 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstring>
+#include <type_traits>
+
+namespace utils
+{
+	/// <summary>
+	/// Appends trivially copyable values and arrays to a byte buffer in the
+	/// machine's native layout. Arrays are prefixed by their length.
+	/// </summary>
+	struct ByteWriter
+	{
+		std::vector<char> buffer;
+
+		void putBytes(const void* data, std::size_t bytes)
+		{
+			const char* p{ static_cast<const char*>(data) };
+			buffer.insert(buffer.end(), p, p + bytes);
+		}
+
+		template<typename T>
+		void put(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			putBytes(&value, sizeof(T));
+		}
+
+		template<typename T>
+		void put(const T* data, std::size_t n)
+		{
+			put((std::uint64_t)n);
+			putBytes(data, n * sizeof(T));
+		}
+
+		template<typename T>
+		void put(const std::vector<T>& v) { put(v.data(), v.size()); }
+	};
+
+	/// <summary>
+	/// Reads back what ByteWriter wrote. Throws on a truncated buffer.
+	/// </summary>
+	struct ByteReader
+	{
+		const std::vector<char>& buffer;
+		std::size_t position{ 0 };
+
+		ByteReader(const std::vector<char>& buffer) : buffer{ buffer } {}
+
+		void getBytes(void* data, std::size_t bytes)
+		{
+			if (position + bytes > buffer.size()) {
+				throw std::runtime_error("Checkpoint is truncated.");
+			}
+			std::memcpy(data, &buffer[position], bytes);
+			position += bytes;
+		}
+
+		template<typename T>
+		T get()
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value;
+			getBytes(&value, sizeof(T));
+			return value;
+		}
+
+		template<typename T>
+		std::vector<T> getVector()
+		{
+			std::uint64_t n{ get<std::uint64_t>() };
+			if (n * sizeof(T) > buffer.size() - position) {
+				throw std::runtime_error("Checkpoint is truncated.");
+			}
+			std::vector<T> v(n);
+			getBytes(v.data(), n * sizeof(T));
+			return v;
+		}
+	};
+
+	inline std::vector<char> readFile(const std::string& path)
+	{
+		std::ifstream f{ path, std::ios::binary | std::ios::ate };
+		if (f.fail()) {
+			throw std::runtime_error("File not found: " + path);
+		}
+		std::vector<char> bytes((std::size_t)f.tellg());
+		f.seekg(0);
+		f.read(bytes.data(), bytes.size());
+		return bytes;
+	}
+
+	/// <summary>
+	/// Writes files on a background thread, one at a time. Each file is
+	/// written to path.tmp and renamed over path once complete, so a crash
+	/// mid-write never leaves a partial file at path. tryWrite does not
+	/// queue: it returns false if the previous write is still running, so
+	/// the caller never waits on the disk.
+	/// </summary>
+	class AsyncFileWriter
+	{
+	private:
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool pending{ false };
+		bool stopping{ false };
+		std::string path;
+		std::vector<char> bytes;
+		std::string error;
+		int nWritten{ 0 };
+		std::thread worker;     // last, so it starts after the state above
+
+		void run()
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			while (true)
+			{
+				wake.wait(lock, [&]() { return pending || stopping; });
+				if (!pending) { return; }
+
+				std::string target{ path };
+				std::vector<char> data{ std::move(bytes) };
+				lock.unlock();
+
+				std::string message;
+				try {
+					std::string tmp{ target + ".tmp" };
+					{
+						std::ofstream f{ tmp, std::ios::binary | std::ios::trunc };
+						f.write(data.data(), data.size());
+						f.close();
+						if (f.fail()) { throw std::runtime_error("Could not write " + tmp); }
+					}
+					std::filesystem::rename(tmp, target);
+				}
+				catch (const std::exception& e) {
+					message = e.what();
+				}
+
+				lock.lock();
+				if (message.empty()) { nWritten++; }
+				else { error = message; }
+				pending = false;
+				wake.notify_all();
+			}
+		}
+
+	public:
+		AsyncFileWriter() : worker{ &AsyncFileWriter::run, this } {}
+
+		// Finishes the write in progress.
+		~AsyncFileWriter()
+		{
+			wait();
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				stopping = true;
+			}
+			wake.notify_all();
+			worker.join();
+		}
+
+		AsyncFileWriter(const AsyncFileWriter&) = delete;
+		AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+		bool busy()
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			return pending;
+		}
+
+		bool tryWrite(const std::string& target, std::vector<char>&& data)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				if (pending) { return false; }
+				path = target;
+				bytes = std::move(data);
+				pending = true;
+			}
+			wake.notify_all();
+			return true;
+		}
+
+		// Blocks until the write in progress (if any) is done.
+		void wait()
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			wake.wait(lock, [&]() { return !pending; });
+		}
+
+		int written()
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			return nWritten;
+		}
+
+		// Last write error, empty if none.
+		std::string lastError()
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			return error;
+		}
+	};
+
+}
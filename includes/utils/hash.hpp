@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace utils
+{
+	/// <summary>
+	/// 64-bit FNV-1a hash of a byte range. Pass the previous result as hash
+	/// to hash several ranges in turn.
+	/// </summary>
+	inline std::uint64_t fnv1a(const void* data, std::size_t bytes, std::uint64_t hash = 14695981039346656037ull)
+	{
+		const unsigned char* p{ static_cast<const unsigned char*>(data) };
+		for (std::size_t i = 0; i < bytes; i++) {
+			hash ^= p[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	std::uint64_t fnv1a(const std::vector<T>& v, std::uint64_t hash = 14695981039346656037ull)
+	{
+		return fnv1a(v.data(), v.size() * sizeof(T), hash);
+	}
+
+}
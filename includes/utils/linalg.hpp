@@ -0,0 +1,307 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+
+namespace utils
+{
+	/// <summary>
+	/// Dense LU factorisation with partial pivoting (PA = LU) of a row-major
+	/// N x N matrix. The matrix is factorised in place, so a solver can hand
+	/// over its influence matrix without holding a second copy. Once
+	/// factorised, any number of right hand sides can be solved in O(N^2).
+	/// Factors may also be viewed in place from storage owned elsewhere, e.g.
+	/// a mapped cache file.
+	/// </summary>
+	class LU
+	{
+	private:
+		int n{ 0 };
+		std::vector<double> lu;
+		std::vector<int> piv;
+
+		// Viewed factors, kept alive by storage.
+		std::shared_ptr<const void> storage;
+		const double* viewLu{ nullptr };
+		const int* viewPiv{ nullptr };
+
+	public:
+		LU() = default;
+
+		/// <param name="a">: Row-major N x N matrix (moved in)</param>
+		/// <param name="n">: Matrix size</param>
+		LU(std::vector<double>&& a, int n)
+			: n{ n }
+			, lu{ std::move(a) }
+			, piv(n)
+		{
+			if (lu.size() != (size_t)n * n) {
+				throw std::invalid_argument("LU: matrix must be N x N.");
+			}
+
+			for (int k{ 0 }; k != n; k++)
+			{
+				// Pivot - largest magnitude in column k.
+				int p{ k };
+				double p_max{ std::abs(lu[(size_t)k * n + k]) };
+				for (int i{ k + 1 }; i != n; i++) {
+					double v{ std::abs(lu[(size_t)i * n + k]) };
+					if (v > p_max) { p_max = v; p = i; }
+				}
+				if (p_max == 0) {
+					throw std::runtime_error("LU: matrix is singular.");
+				}
+
+				piv[k] = p;
+				if (p != k) {
+					std::swap_ranges(
+						lu.begin() + (size_t)k * n, lu.begin() + (size_t)(k + 1) * n,
+						lu.begin() + (size_t)p * n
+					);
+				}
+
+				// Rank-1 update of trailing rows. Inner loop is contiguous.
+				const double* row_k{ &lu[(size_t)k * n] };
+				const double inv_pivot{ 1 / row_k[k] };
+				for (int i{ k + 1 }; i != n; i++)
+				{
+					double* row_i{ &lu[(size_t)i * n] };
+					const double l_ik{ row_i[k] * inv_pivot };
+					row_i[k] = l_ik;
+					if (l_ik == 0) { continue; }
+
+					for (int j{ k + 1 }; j != n; j++) {
+						row_i[j] -= l_ik * row_k[j];
+					}
+				}
+			}
+		}
+
+		/// <param name="storage">: Owner of the factor buffers</param>
+		/// <param name="factors">: Row-major N x N LU factors, as factors()</param>
+		/// <param name="pivots">: N row swaps, as pivots()</param>
+		LU(std::shared_ptr<const void> storage, const double* factors, const int* pivots, int n)
+			: n{ n }
+			, storage{ std::move(storage) }
+			, viewLu{ factors }
+			, viewPiv{ pivots }
+		{
+		}
+
+		int size() const { return n; }
+		bool empty() const { return n == 0; }
+
+		// Unit lower and upper triangles in one row-major N x N buffer.
+		const double* factors() const { return viewLu != nullptr ? viewLu : lu.data(); }
+		// Row swapped with row k at step k.
+		const int* pivots() const { return viewPiv != nullptr ? viewPiv : piv.data(); }
+
+		/// <summary>
+		/// Solves Ax = b in place.
+		/// </summary>
+		/// <param name="x">: Right hand side on input, solution on output</param>
+		void solve(double* x) const
+		{
+			const double* lu{ factors() };
+			const int* piv{ pivots() };
+
+			for (int k{ 0 }; k != n; k++) {
+				if (piv[k] != k) { std::swap(x[k], x[piv[k]]); }
+			}
+
+			// Forward substitution - unit lower triangle.
+			for (int i{ 1 }; i < n; i++) {
+				const double* row_i{ &lu[(size_t)i * n] };
+				double s{ x[i] };
+				for (int j{ 0 }; j != i; j++) { s -= row_i[j] * x[j]; }
+				x[i] = s;
+			}
+
+			// Back substitution - upper triangle.
+			for (int i{ n - 1 }; i >= 0; i--) {
+				const double* row_i{ &lu[(size_t)i * n] };
+				double s{ x[i] };
+				for (int j{ i + 1 }; j < n; j++) { s -= row_i[j] * x[j]; }
+				x[i] = s / row_i[i];
+			}
+		}
+
+		/// <summary>
+		/// Solves AX = B in place for nrhs right hand sides at once. X is
+		/// row-major N x nrhs, so each elimination step updates a contiguous
+		/// row of all right hand sides.
+		/// </summary>
+		void solve(double* X, int nrhs) const
+		{
+			const double* lu{ factors() };
+			const int* piv{ pivots() };
+
+			for (int k{ 0 }; k != n; k++) {
+				if (piv[k] != k) {
+					std::swap_ranges(
+						X + (size_t)k * nrhs, X + (size_t)(k + 1) * nrhs,
+						X + (size_t)piv[k] * nrhs
+					);
+				}
+			}
+
+			for (int i{ 1 }; i < n; i++) {
+				const double* row_i{ &lu[(size_t)i * n] };
+				double* X_i{ X + (size_t)i * nrhs };
+				for (int j{ 0 }; j != i; j++) {
+					const double l_ij{ row_i[j] };
+					const double* X_j{ X + (size_t)j * nrhs };
+					for (int c{ 0 }; c != nrhs; c++) { X_i[c] -= l_ij * X_j[c]; }
+				}
+			}
+
+			for (int i{ n - 1 }; i >= 0; i--) {
+				const double* row_i{ &lu[(size_t)i * n] };
+				double* X_i{ X + (size_t)i * nrhs };
+				for (int j{ i + 1 }; j < n; j++) {
+					const double u_ij{ row_i[j] };
+					const double* X_j{ X + (size_t)j * nrhs };
+					for (int c{ 0 }; c != nrhs; c++) { X_i[c] -= u_ij * X_j[c]; }
+				}
+				const double inv_diag{ 1 / row_i[i] };
+				for (int c{ 0 }; c != nrhs; c++) { X_i[c] *= inv_diag; }
+			}
+		}
+	};
+
+	struct GmresResult
+	{
+		int iterations{ 0 };
+		double residual{ 0 };	// ||b - Ax|| / ||b||
+		bool converged{ false };
+	};
+
+	/// <summary>
+	/// Restarted GMRES(restart) with right preconditioning, for the
+	/// N x N system Ax = b, starting from the guess in x. The matrix is only
+	/// used through products, so callers can run them in parallel. A good
+	/// initial guess (e.g. a coarser solution) cuts the iteration count; each
+	/// iteration is one product, O(N^2) for a dense matrix.
+	/// 
+	/// See Saad & Schultz (1986).
+	/// </summary>
+	/// <param name="matVec">: matVec(v, Av) writes A v</param>
+	/// <param name="precond">: precond(v, Mv) writes M^-1 v</param>
+	/// <param name="b">: Right hand side</param>
+	/// <param name="x">: Initial guess on input, solution on output</param>
+	template<typename MatVec, typename Precond>
+	GmresResult gmres(
+		int n, MatVec&& matVec, Precond&& precond, const double* b, double* x,
+		double tolerance = 1e-10, int maxIterations = 500, int restart = 50
+	)
+	{
+		auto dot = [n](const double* u, const double* v) {
+			double s{ 0 };
+			for (int i{ 0 }; i != n; i++) { s += u[i] * v[i]; }
+			return s;
+		};
+
+		GmresResult result;
+		restart = std::max(1, std::min(restart, n));
+
+		double b_norm{ std::sqrt(dot(b, b)) };
+		if (b_norm == 0) { b_norm = 1; }
+
+		// Krylov basis (restart + 1) x n and Hessenberg matrix (restart + 1) x restart.
+		std::vector<double> V((size_t)(restart + 1) * n);
+		std::vector<double> H((size_t)(restart + 1) * restart);
+		std::vector<double> cs(restart), sn(restart), g(restart + 1);
+		std::vector<double> w(n), z(n);
+
+		while (true)
+		{
+			// r = b - Ax
+			double* r{ V.data() };
+			matVec(x, r);
+			for (int i{ 0 }; i != n; i++) { r[i] = b[i] - r[i]; }
+
+			double beta{ std::sqrt(dot(r, r)) };
+			result.residual = beta / b_norm;
+			if (result.residual < tolerance) {
+				result.converged = true;
+				return result;
+			}
+			if (result.iterations >= maxIterations) { return result; }
+
+			for (int i{ 0 }; i != n; i++) { r[i] /= beta; }
+			std::fill(g.begin(), g.end(), 0.0);
+			g[0] = beta;
+
+			// Arnoldi (modified Gram-Schmidt) with Givens rotations.
+			int k{ 0 };
+			for (; k != restart && result.iterations < maxIterations; k++)
+			{
+				result.iterations++;
+
+				precond(&V[(size_t)k * n], z.data());
+				matVec(z.data(), w.data());
+
+				for (int j{ 0 }; j <= k; j++)
+				{
+					const double* v_j{ &V[(size_t)j * n] };
+					double h{ dot(w.data(), v_j) };
+					H[(size_t)j * restart + k] = h;
+					for (int i{ 0 }; i != n; i++) { w[i] -= h * v_j[i]; }
+				}
+
+				double h_next{ std::sqrt(dot(w.data(), w.data())) };
+				H[(size_t)(k + 1) * restart + k] = h_next;
+				if (h_next != 0) {
+					double* v_next{ &V[(size_t)(k + 1) * n] };
+					for (int i{ 0 }; i != n; i++) { v_next[i] = w[i] / h_next; }
+				}
+
+				for (int j{ 0 }; j != k; j++)
+				{
+					double h0{ H[(size_t)j * restart + k] };
+					double h1{ H[(size_t)(j + 1) * restart + k] };
+					H[(size_t)j * restart + k] = cs[j] * h0 + sn[j] * h1;
+					H[(size_t)(j + 1) * restart + k] = -sn[j] * h0 + cs[j] * h1;
+				}
+
+				double h0{ H[(size_t)k * restart + k] };
+				double rho{ std::hypot(h0, h_next) };
+				cs[k] = rho == 0 ? 1 : h0 / rho;
+				sn[k] = rho == 0 ? 0 : h_next / rho;
+				H[(size_t)k * restart + k] = rho;
+				H[(size_t)(k + 1) * restart + k] = 0;
+
+				g[k + 1] = -sn[k] * g[k];
+				g[k] = cs[k] * g[k];
+
+				if (std::abs(g[k + 1]) / b_norm < tolerance || h_next == 0) {
+					k++;
+					break;
+				}
+			}
+
+			// Back substitute H y = g, then x += M^-1 V y.
+			std::vector<double> y(k);
+			for (int j{ k - 1 }; j >= 0; j--)
+			{
+				double s{ g[j] };
+				for (int l{ j + 1 }; l != k; l++) { s -= H[(size_t)j * restart + l] * y[l]; }
+				y[j] = s / H[(size_t)j * restart + j];
+			}
+
+			std::fill(w.begin(), w.end(), 0.0);
+			for (int j{ 0 }; j != k; j++)
+			{
+				const double* v_j{ &V[(size_t)j * n] };
+				for (int i{ 0 }; i != n; i++) { w[i] += y[j] * v_j[i]; }
+			}
+			precond(w.data(), z.data());
+			for (int i{ 0 }; i != n; i++) { x[i] += z[i]; }
+		}
+	}
+
+}
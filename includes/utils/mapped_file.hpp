@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <stdexcept>
+
+#if defined(_WIN32)
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace utils
+{
+	/// <summary>
+	/// Private, copy-on-write memory map of a whole file. Pages are read from
+	/// disk on first touch; writes go to private copies of the touched pages
+	/// and never reach the file. Throws if the file cannot be mapped.
+	/// </summary>
+	class MappedFile
+	{
+	private:
+		char* data_{ nullptr };
+		std::size_t size_{ 0 };
+
+#if defined(_WIN32)
+		HANDLE file{ INVALID_HANDLE_VALUE };
+		HANDLE mapping{ nullptr };
+#endif
+
+		void unmap()
+		{
+#if defined(_WIN32)
+			if (data_ != nullptr) { UnmapViewOfFile(data_); }
+			if (mapping != nullptr) { CloseHandle(mapping); }
+			if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (data_ != nullptr) { munmap(data_, size_); }
+#endif
+			data_ = nullptr;
+			size_ = 0;
+		}
+
+	public:
+		MappedFile(const std::string& path)
+		{
+#if defined(_WIN32)
+			file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+				nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			LARGE_INTEGER size;
+			if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+				unmap();
+				throw std::runtime_error("Could not map " + path);
+			}
+			size_ = (std::size_t)size.QuadPart;
+
+			mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			if (mapping != nullptr) {
+				data_ = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+			}
+			if (data_ == nullptr) {
+				unmap();
+				throw std::runtime_error("Could not map " + path);
+			}
+#else
+			int fd{ open(path.c_str(), O_RDONLY) };
+			struct stat info;
+			if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+				if (fd >= 0) { close(fd); }
+				throw std::runtime_error("Could not map " + path);
+			}
+			size_ = (std::size_t)info.st_size;
+
+			void* p{ mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) };
+			close(fd);	// the mapping keeps the file open
+			if (p == MAP_FAILED) {
+				size_ = 0;
+				throw std::runtime_error("Could not map " + path);
+			}
+			data_ = static_cast<char*>(p);
+#endif
+		}
+
+		~MappedFile() { unmap(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		char* data() { return data_; }
+		const char* data() const { return data_; }
+		std::size_t size() const { return size_; }
+	};
+
+}
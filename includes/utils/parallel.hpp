@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace utils
+{
+	/// <summary>
+	/// Number of worker threads to use when none is given.
+	/// </summary>
+	inline int defaultThreads()
+	{
+		return std::max((int)std::thread::hardware_concurrency(), 1);
+	}
+
+	/// <summary>
+	/// Splits [0, n) into chunks of at least minChunk and runs
+	/// body(begin, end) on each, pulling chunks from a shared counter on up to
+	/// nThreads threads. Runs inline if only one chunk is needed.
+	/// </summary>
+	template<typename Body>
+	void parallelFor(int n, Body&& body, int nThreads = 0, int minChunk = 16)
+	{
+		if (n <= 0) { return; }
+		if (nThreads <= 0) { nThreads = defaultThreads(); }
+
+		// ~4 chunks per thread balances uneven rows without much overhead.
+		int chunk{ std::max(minChunk, n / (4 * nThreads) + 1) };
+		int n_chunks{ (n + chunk - 1) / chunk };
+		int n_workers{ std::min(nThreads, n_chunks) };
+
+		if (n_workers <= 1) {
+			body(0, n);
+			return;
+		}
+
+		std::atomic<int> next{ 0 };
+		auto worker = [&]() {
+			for (int c{ next++ }; c < n_chunks; c = next++) {
+				body(c * chunk, std::min(n, (c + 1) * chunk));
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (int t{ 1 }; t != n_workers; t++) {
+			workers.emplace_back(worker);
+		}
+		worker();
+		for (std::thread& t : workers) {
+			t.join();
+		}
+	}
+
+}
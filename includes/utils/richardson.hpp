@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+namespace utils
+{
+	/// <summary>
+	/// Richardson extrapolation of a quantity solved on three meshes.
+	/// </summary>
+	struct Richardson
+	{
+		double extrapolated{ 0 };	// estimate at zero mesh size
+		double order{ 0 };			// observed order of convergence
+		double error{ 0 };			// |extrapolated - fine|
+		double gci{ 0 };			// fine grid convergence index (relative)
+		bool monotonic{ true };		// false if solutions oscillate
+	};
+
+	/// <summary>
+	/// Observed order, extrapolated value and grid convergence index from
+	/// solutions phi on meshes of representative size h, ordered fine to
+	/// coarse. Refinement ratios need not be constant:
+	///		p = |ln|e32 / e21| + ln((r21^p - s) / (r32^p - s))| / ln r21
+	/// is solved by fixed point iteration, with e21 = phi2 - phi1,
+	/// e32 = phi3 - phi2, r21 = h2 / h1, r32 = h3 / h2, s = sign(e32 / e21).
+	/// GCI uses a safety factor of 1.25.
+	///
+	/// See Celik et al. (2008), J. Fluids Eng. 130(7).
+	/// </summary>
+	inline Richardson richardson(const std::array<double, 3>& phi, const std::array<double, 3>& h)
+	{
+		Richardson result;
+
+		const double e21{ phi[1] - phi[0] };
+		const double e32{ phi[2] - phi[1] };
+		const double r21{ h[1] / h[0] };
+		const double r32{ h[2] / h[1] };
+
+		// Converged to round-off on the two finer meshes.
+		if (e21 == 0 || e32 == 0) {
+			result.extrapolated = phi[0];
+			return result;
+		}
+
+		const double s{ e32 / e21 > 0 ? 1.0 : -1.0 };
+		result.monotonic = s > 0;
+
+		double p{ std::abs(std::log(std::abs(e32 / e21))) / std::log(r21) };
+		for (int k{ 0 }; k != 100; k++)
+		{
+			double q{ std::log((std::pow(r21, p) - s) / (std::pow(r32, p) - s)) };
+			double p_next{ std::abs(std::log(std::abs(e32 / e21)) + q) / std::log(r21) };
+			if (!std::isfinite(p_next)) { break; }
+
+			bool converged{ std::abs(p_next - p) < 1e-10 * std::max(1.0, p) };
+			p = p_next;
+			if (converged) { break; }
+		}
+		result.order = p;
+
+		const double e_a{ phi[0] != 0 ? std::abs(e21 / phi[0]) : std::abs(e21) };
+
+		// No observable convergence - fall back to the fine solution.
+		if (!(p > 0) || !std::isfinite(p)) {
+			result.order = 0;
+			result.extrapolated = phi[0];
+			result.error = std::abs(e21);
+			result.gci = 1.25 * e_a;
+			return result;
+		}
+
+		const double r21_p{ std::pow(r21, p) };
+		result.extrapolated = (r21_p * phi[0] - phi[1]) / (r21_p - 1);
+		result.error = std::abs(result.extrapolated - phi[0]);
+
+		result.gci = 1.25 * e_a / (r21_p - 1);
+
+		return result;
+	}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+namespace utils
+{
+	/// <summary>
+	/// Panel node distribution over [0, 1]. Node k of m panels is at
+	///		uniform:				k / m
+	///		cosine:					(1 - cos(pi u)) / 2, clustered at both ends
+	///		half_cosine:			sin(pi u / 2), clustered at the end
+	///		half_cosine_start:		1 - cos(pi u / 2), clustered at the start
+	///		tanh:					(1 + tanh(b (u - 1/2)) / tanh(b / 2)) / 2,
+	///								clustered at both ends by b = clustering
+	///		custom:					points[k] (m + 1 values from 0 to 1)
+	/// with u = k / m.
+	/// </summary>
+	struct Spacing
+	{
+		enum class Type { uniform, cosine, half_cosine, half_cosine_start, tanh, custom };
+
+		Type type{ Type::uniform };
+		double clustering{ 2 };
+		std::vector<double> points;
+
+		bool uniform() const { return type == Type::uniform; }
+
+		double operator()(int k, int m) const
+		{
+			const double pi{ 3.14159265358979323846 };
+			const double u{ (double)k / m };
+
+			switch (type)
+			{
+			case Type::cosine: return 0.5 * (1 - std::cos(pi * u));
+			case Type::half_cosine: return std::sin(0.5 * pi * u);
+			case Type::half_cosine_start: return 1 - std::cos(0.5 * pi * u);
+			case Type::tanh:
+				return 0.5 * (1 + std::tanh(clustering * (u - 0.5)) / std::tanh(0.5 * clustering));
+			case Type::custom: return points[k];
+			case Type::uniform:
+			default:
+				return u;
+			}
+		}
+
+		// Same distribution over m_new panels instead of m. Custom node lists
+		// are interpolated linearly in node index, so an integer ratio
+		// subdivides every panel equally.
+		Spacing resampled(int m, int m_new) const
+		{
+			if (type != Type::custom || m_new == m) { return *this; }
+
+			Spacing spacing{ *this };
+			spacing.points.resize(m_new + 1);
+			for (int k = 0; k <= m_new; k++)
+			{
+				double u{ (double)k * m / m_new };
+				int k0{ std::min((int)u, m - 1) };
+				double t{ u - k0 };
+				spacing.points[k] = (1 - t) * points[k0] + t * points[k0 + 1];
+			}
+			spacing.points.front() = 0;
+			spacing.points.back() = 1;
+			return spacing;
+		}
+
+		// Throws if a custom distribution does not fit m panels.
+		void check(int m) const
+		{
+			if (type == Type::tanh && clustering <= 0) {
+				throw std::invalid_argument("tanh spacing needs a positive clustering.");
+			}
+			if (type != Type::custom) { return; }
+
+			if ((int)points.size() != m + 1) {
+				throw std::invalid_argument(
+					"Custom spacing needs " + std::to_string(m + 1) + " points.");
+			}
+			if (points.front() != 0 || points.back() != 1) {
+				throw std::invalid_argument("Custom spacing must run from 0 to 1.");
+			}
+			for (int k = 1; k <= m; k++) {
+				if (points[k] <= points[k - 1]) {
+					throw std::invalid_argument("Custom spacing must be increasing.");
+				}
+			}
+		}
+	};
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+namespace utils
+{
+	/// <summary>
+	/// Streaming quantile estimate using the P-squared algorithm (Jain &
+	/// Chlamtac, 1985). Holds five markers regardless of sample count.
+	/// </summary>
+	class P2Quantile
+	{
+	private:
+		double p;
+		long long count{ 0 };
+		std::array<double, 5> q{};		// marker heights
+		std::array<double, 5> n{};		// marker positions
+		std::array<double, 5> np{};		// desired positions
+		std::array<double, 5> dn{};		// desired position increments
+
+		double parabolic(int i, double d) const
+		{
+			return q[i] + d / (n[i + 1] - n[i - 1]) * (
+				(n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i])
+				+ (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1])
+			);
+		}
+
+		double linear(int i, int d) const
+		{
+			return q[i] + d * (q[i + d] - q[i]) / (n[i + d] - n[i]);
+		}
+
+	public:
+		P2Quantile(double p)
+			: p{ p }
+			, dn{ 0, p / 2, p, (1 + p) / 2, 1 }
+		{
+
+		}
+
+		void add(double x)
+		{
+			// Initialisation - first 5 observations are kept exactly.
+			if (count < 5)
+			{
+				q[count] = x;
+				count++;
+
+				if (count == 5) {
+					std::sort(q.begin(), q.end());
+					for (int i{ 0 }; i != 5; i++) { n[i] = i + 1; }
+					np = { 1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5 };
+				}
+				return;
+			}
+			count++;
+
+			// Cell containing x.
+			int k;
+			if (x < q[0]) { q[0] = x; k = 0; }
+			else if (x >= q[4]) { q[4] = x; k = 3; }
+			else {
+				k = 0;
+				while (x >= q[k + 1]) { k++; }
+			}
+
+			for (int i{ k + 1 }; i != 5; i++) { n[i]++; }
+			for (int i{ 0 }; i != 5; i++) { np[i] += dn[i]; }
+
+			// Adjust middle markers.
+			for (int i{ 1 }; i != 4; i++)
+			{
+				double d{ np[i] - n[i] };
+				if ((d >= 1 && n[i + 1] - n[i] > 1) || (d <= -1 && n[i - 1] - n[i] < -1))
+				{
+					int d_sign{ d > 0 ? 1 : -1 };
+					double q_new{ parabolic(i, d_sign) };
+					if (q[i - 1] < q_new && q_new < q[i + 1]) { q[i] = q_new; }
+					else { q[i] = linear(i, d_sign); }
+
+					n[i] += d_sign;
+				}
+			}
+		}
+
+		double probability() const { return p; }
+
+		double value() const
+		{
+			if (count == 0) { return 0; }
+			if (count < 5)
+			{
+				std::vector<double> sorted(q.begin(), q.begin() + count);
+				std::sort(sorted.begin(), sorted.end());
+				int i{ (int)std::round(p * (count - 1)) };
+				return sorted[i];
+			}
+			return q[2];
+		}
+	};
+
+	/// <summary>
+	/// Running mean/variance (Welford) and streaming quantiles of a scalar.
+	/// Memory use is independent of the number of samples.
+	/// </summary>
+	class RunningStats
+	{
+	private:
+		long long n{ 0 };
+		double mean_{ 0 };
+		double M2{ 0 };
+		double min_{ 0 };
+		double max_{ 0 };
+		std::vector<P2Quantile> quantiles_;
+
+	public:
+		RunningStats(const std::vector<double>& probabilities = { 0.05, 0.5, 0.95 })
+		{
+			for (double p : probabilities) { quantiles_.emplace_back(p); }
+		}
+
+		void add(double x)
+		{
+			n++;
+			double delta{ x - mean_ };
+			mean_ += delta / n;
+			M2 += delta * (x - mean_);
+
+			if (n == 1) { min_ = x; max_ = x; }
+			min_ = std::min(min_, x);
+			max_ = std::max(max_, x);
+
+			for (P2Quantile& quantile : quantiles_) { quantile.add(x); }
+		}
+
+		long long count() const { return n; }
+		double mean() const { return mean_; }
+		double variance() const { return n > 1 ? M2 / (n - 1) : 0; }
+		double stddev() const { return std::sqrt(variance()); }
+		double min() const { return min_; }
+		double max() const { return max_; }
+		const std::vector<P2Quantile>& quantiles() const { return quantiles_; }
+	};
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <charconv>
+#include <cstring>
+
+namespace utils
+{
+	/// <summary>
+	/// Reads a whole file into text in one read. Returns false if the file
+	/// cannot be opened (readFile in checkpoint.hpp throws instead).
+	/// </summary>
+	inline bool readText(const std::string& path, std::string& text)
+	{
+		std::ifstream file{ path, std::ios::binary | std::ios::ate };
+		if (file.fail()) { return false; }
+
+		const std::streamoff size{ file.tellg() };
+		text.resize(size > 0 ? (std::size_t)size : 0);
+		file.seekg(0);
+		file.read(text.data(), (std::streamsize)text.size());
+		text.resize((std::size_t)file.gcount());
+		return true;
+	}
+
+	/// <summary>
+	/// Calls line(first, last) for every line of [first, last), without the
+	/// line break ("\n" or "\r\n").
+	/// </summary>
+	template<typename Line>
+	void forEachLine(const char* first, const char* last, Line&& line)
+	{
+		while (first < last)
+		{
+			const char* end{ static_cast<const char*>(std::memchr(first, '\n', last - first)) };
+			if (end == nullptr) { end = last; }
+
+			const char* line_end{ end };
+			if (line_end > first && line_end[-1] == '\r') { line_end--; }
+			line(first, line_end);
+
+			first = end + 1;
+		}
+	}
+
+	/// <summary>
+	/// Parses a line of whitespace (space or tab) separated numbers in place.
+	/// </summary>
+	/// <returns>Number of fields, or -1 if a field is not a number or there
+	/// are more than maxValues fields.</returns>
+	inline int parseNumbers(const char* first, const char* last, double* values, int maxValues)
+	{
+		int count{ 0 };
+		while (true)
+		{
+			while (first != last && (*first == ' ' || *first == '\t')) { first++; }
+			if (first == last) { return count; }
+			if (count == maxValues) { return -1; }
+
+			// from_chars does not take a leading '+'.
+			if (*first == '+') { first++; }
+
+			const std::from_chars_result result{ std::from_chars(first, last, values[count]) };
+			if (result.ec != std::errc{}) { return -1; }
+
+			// The whole field must be numeric.
+			first = result.ptr;
+			if (first != last && *first != ' ' && *first != '\t') { return -1; }
+
+			count++;
+		}
+	}
+
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+
+#include <utils/vortex.hpp>
+
+namespace utils
+{
+	/// <summary>
+	/// Barnes-Hut tree code for the velocity induced by many vortex segments.
+	/// Segments are sorted into a binary tree by midpoint (split along the
+	/// longest axis). A cluster far enough from the target - radius /
+	/// distance below the opening angle theta - is replaced by a single
+	/// vortex stick at its centroid carrying the summed vector strength
+	/// sum(G (P2 - P1)); closer clusters are opened, and leaves are summed
+	/// directly. A query costs O(log S) for S segments, building O(S log S).
+	///
+	/// The direct kernel is regularised with a core of radius delta:
+	///		|r1 x r2|^2 -> |r1 x r2|^2 + delta^2 |r0|^2
+	/// which keeps wake nodes passing close to another filament bounded.
+	/// </summary>
+	class SegmentTree
+	{
+	private:
+		struct Node {
+			std::array<double, 3> centre{};		// strength weighted centroid
+			std::array<double, 3> strength{};	// sum of G (P2 - P1)
+			double radius{ 0 };
+			int first{ 0 };
+			int count{ 0 };
+			int left{ -1 };
+			int right{ -1 };
+		};
+
+		Segments segments;				// sorted so nodes cover ranges
+		std::vector<double> strengths;
+		std::vector<Node> nodes;
+		int leafSize;
+
+		int build(std::vector<int>& order, int first, int count)
+		{
+			int index{ (int)nodes.size() };
+			nodes.emplace_back();
+			nodes[index].first = first;
+			nodes[index].count = count;
+
+			if (count > leafSize)
+			{
+				std::array<double, 3> lo{ 1e300, 1e300, 1e300 };
+				std::array<double, 3> hi{ -1e300, -1e300, -1e300 };
+				for (int k{ first }; k != first + count; k++) {
+					std::array<double, 3> mid{ midpoint(order[k]) };
+					for (int d{ 0 }; d != 3; d++) {
+						lo[d] = std::min(lo[d], mid[d]);
+						hi[d] = std::max(hi[d], mid[d]);
+					}
+				}
+				int axis{ 0 };
+				for (int d{ 1 }; d != 3; d++) {
+					if (hi[d] - lo[d] > hi[axis] - lo[axis]) { axis = d; }
+				}
+
+				int half{ count / 2 };
+				std::nth_element(
+					order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+					[&](int a, int b) { return midpoint(a)[axis] < midpoint(b)[axis]; }
+				);
+
+				int left{ build(order, first, half) };
+				int right{ build(order, first + half, count - half) };
+				nodes[index].left = left;
+				nodes[index].right = right;
+			}
+
+			return index;
+		}
+
+		std::array<double, 3> midpoint(int k) const
+		{
+			return {
+				0.5 * (segments.x1[k] + segments.x2[k]),
+				0.5 * (segments.y1[k] + segments.y2[k]),
+				0.5 * (segments.z1[k] + segments.z2[k])
+			};
+		}
+
+		// Cluster strength, centroid and radius from the (sorted) segments.
+		void summarise(Node& node) const
+		{
+			double weight{ 0 };
+			std::array<double, 3> centre{};
+			std::array<double, 3> geometric{};
+
+			for (int k{ node.first }; k != node.first + node.count; k++)
+			{
+				double dx{ segments.x2[k] - segments.x1[k] };
+				double dy{ segments.y2[k] - segments.y1[k] };
+				double dz{ segments.z2[k] - segments.z1[k] };
+				double g{ strengths[k] };
+
+				node.strength[0] += g * dx;
+				node.strength[1] += g * dy;
+				node.strength[2] += g * dz;
+
+				std::array<double, 3> mid{ midpoint(k) };
+				double wk{ std::abs(g) * std::sqrt(dx * dx + dy * dy + dz * dz) };
+				weight += wk;
+				for (int d{ 0 }; d != 3; d++) {
+					centre[d] += wk * mid[d];
+					geometric[d] += mid[d] / node.count;
+				}
+			}
+			for (int d{ 0 }; d != 3; d++) {
+				node.centre[d] = weight > 0 ? centre[d] / weight : geometric[d];
+			}
+
+			for (int k{ node.first }; k != node.first + node.count; k++)
+			{
+				double r1{ std::hypot(segments.x1[k] - node.centre[0],
+					segments.y1[k] - node.centre[1], segments.z1[k] - node.centre[2]) };
+				double r2{ std::hypot(segments.x2[k] - node.centre[0],
+					segments.y2[k] - node.centre[1], segments.z2[k] - node.centre[2]) };
+				node.radius = std::max(node.radius, std::max(r1, r2));
+			}
+		}
+
+	public:
+		SegmentTree(const Segments& source, const std::vector<double>& sourceStrengths, int leafSize = 16)
+			: leafSize{ std::max(leafSize, 1) }
+		{
+			const int S{ source.size() };
+			if (S == 0) { return; }
+
+			std::vector<int> order(S);
+			std::iota(order.begin(), order.end(), 0);
+
+			segments = source;	// midpoints are read from here while building
+			nodes.reserve(2 * (S / this->leafSize + 1));
+			build(order, 0, S);
+
+			// Store segments in tree order so every node is a contiguous range.
+			segments.clear();
+			segments.reserve(S);
+			strengths.resize(S);
+			for (int k{ 0 }; k != S; k++)
+			{
+				int s{ order[k] };
+				double P1[3]{ source.x1[s], source.y1[s], source.z1[s] };
+				double P2[3]{ source.x2[s], source.y2[s], source.z2[s] };
+				segments.add(P1, P2);
+				strengths[k] = sourceStrengths[s];
+			}
+
+			for (Node& node : nodes) { summarise(node); }
+		}
+
+		int size() const { return segments.size(); }
+
+		/// <summary>
+		/// Velocity induced at (x, y, z).
+		/// </summary>
+		/// <param name="theta">Opening angle (0 = direct sum)</param>
+		/// <param name="delta">Core radius of the direct kernel</param>
+		std::array<double, 3> velocity(double x, double y, double z, double theta, double delta) const
+		{
+			std::array<double, 3> q{ 0, 0, 0 };
+			if (nodes.empty()) { return q; }
+
+			const double inv_4pi{ 1 / (4 * 3.14159265358979323846) };
+			const double delta2{ delta * delta };
+
+			int stack[128];
+			int top{ 0 };
+			stack[top++] = 0;
+
+			while (top > 0)
+			{
+				const Node& node{ nodes[stack[--top]] };
+
+				double rx{ x - node.centre[0] };
+				double ry{ y - node.centre[1] };
+				double rz{ z - node.centre[2] };
+				double r2{ rx * rx + ry * ry + rz * rz };
+
+				// Far field - vortex stick at the centroid.
+				if (node.radius * node.radius < theta * theta * r2)
+				{
+					const std::array<double, 3>& a{ node.strength };
+					double K{ inv_4pi / std::pow(r2 + delta2, 1.5) };
+					q[0] += K * (a[1] * rz - a[2] * ry);
+					q[1] += K * (a[2] * rx - a[0] * rz);
+					q[2] += K * (a[0] * ry - a[1] * rx);
+					continue;
+				}
+
+				if (node.left >= 0) {
+					stack[top++] = node.left;
+					stack[top++] = node.right;
+					continue;
+				}
+
+				// Leaf - direct regularised sum.
+				for (int k{ node.first }; k != node.first + node.count; k++)
+				{
+					double r1x{ x - segments.x1[k] }, r1y{ y - segments.y1[k] }, r1z{ z - segments.z1[k] };
+					double r2x{ x - segments.x2[k] }, r2y{ y - segments.y2[k] }, r2z{ z - segments.z2[k] };
+					double r0x{ r1x - r2x }, r0y{ r1y - r2y }, r0z{ r1z - r2z };
+
+					double cx{ r1y * r2z - r1z * r2y };
+					double cy{ r1z * r2x - r1x * r2z };
+					double cz{ r1x * r2y - r1y * r2x };
+					double c2{ cx * cx + cy * cy + cz * cz + delta2 * (r0x * r0x + r0y * r0y + r0z * r0z) };
+
+					double r1{ std::sqrt(r1x * r1x + r1y * r1y + r1z * r1z) };
+					double rr2{ std::sqrt(r2x * r2x + r2y * r2y + r2z * r2z) };
+
+					bool singular{ r1 < 1e-12 || rr2 < 1e-12 || c2 < 1e-24 };
+					double K{ strengths[k] * inv_4pi / c2 * (
+						(r0x * r1x + r0y * r1y + r0z * r1z) / r1
+						- (r0x * r2x + r0y * r2y + r0z * r2z) / rr2) };
+					K = singular ? 0.0 : K;
+
+					q[0] += K * cx;
+					q[1] += K * cy;
+					q[2] += K * cz;
+				}
+			}
+
+			return q;
+		}
+	};
+
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+
+namespace utils
+{
+	/// <summary>
+	/// Straight vortex segments P1 -> P2 in structure-of-arrays layout, so the
+	/// Biot-Savart loop over segments runs on contiguous arrays and can be
+	/// vectorised by the compiler.
+	/// </summary>
+	struct Segments
+	{
+		std::vector<double> x1, y1, z1;
+		std::vector<double> x2, y2, z2;
+
+		int size() const { return (int)x1.size(); }
+
+		void reserve(int n)
+		{
+			for (std::vector<double>* v : { &x1, &y1, &z1, &x2, &y2, &z2 }) {
+				v->reserve(n);
+			}
+		}
+
+		void clear()
+		{
+			for (std::vector<double>* v : { &x1, &y1, &z1, &x2, &y2, &z2 }) {
+				v->clear();
+			}
+		}
+
+		void add(const double* P1, const double* P2)
+		{
+			x1.push_back(P1[0]); y1.push_back(P1[1]); z1.push_back(P1[2]);
+			x2.push_back(P2[0]); y2.push_back(P2[1]); z2.push_back(P2[2]);
+		}
+	};
+
+	/// <summary>
+	/// Velocity induced at (x, y, z) by a unit strength line vortex P1 -> P2
+	/// (Katz & Plotkin, 10.4.5). Returns zero within R of the vortex line.
+	/// </summary>
+	inline std::array<double, 3> lineVortex(
+		double x, double y, double z,
+		double x1, double y1, double z1,
+		double x2, double y2, double z2,
+		double R
+	)
+	{
+		double r1x{ x - x1 }, r1y{ y - y1 }, r1z{ z - z1 };
+		double r2x{ x - x2 }, r2y{ y - y2 }, r2z{ z - z2 };
+
+		double cx{ r1y * r2z - r1z * r2y };
+		double cy{ r1z * r2x - r1x * r2z };
+		double cz{ r1x * r2y - r1y * r2x };
+		double c2{ cx * cx + cy * cy + cz * cz };
+
+		double r1{ std::sqrt(r1x * r1x + r1y * r1y + r1z * r1z) };
+		double r2{ std::sqrt(r2x * r2x + r2y * r2y + r2z * r2z) };
+
+		if (r1 < R || r2 < R || c2 < R) { return { 0, 0, 0 }; }
+
+		double r0x{ x2 - x1 }, r0y{ y2 - y1 }, r0z{ z2 - z1 };
+		double r0r1{ r0x * r1x + r0y * r1y + r0z * r1z };
+		double r0r2{ r0x * r2x + r0y * r2y + r0z * r2z };
+
+		double K{ (r0r1 / r1 - r0r2 / r2) / (4 * 3.14159265358979323846 * c2) };
+
+		return { K * cx, K * cy, K * cz };
+	}
+
+	/// <summary>
+	/// Velocity induced at (x, y, z) by every unit strength segment in s,
+	/// written to u, v, w (length s.size()). Branch free so the loop
+	/// vectorises; the singular case is masked after the division.
+	/// </summary>
+	inline void lineVortices(
+		const Segments& s, double x, double y, double z, double R,
+		double* __restrict u, double* __restrict v, double* __restrict w
+	)
+	{
+		const int n{ s.size() };
+		const double* __restrict x1{ s.x1.data() };
+		const double* __restrict y1{ s.y1.data() };
+		const double* __restrict z1{ s.z1.data() };
+		const double* __restrict x2{ s.x2.data() };
+		const double* __restrict y2{ s.y2.data() };
+		const double* __restrict z2{ s.z2.data() };
+
+		const double inv_4pi{ 1 / (4 * 3.14159265358979323846) };
+
+		for (int k = 0; k < n; k++)
+		{
+			double r1x{ x - x1[k] }, r1y{ y - y1[k] }, r1z{ z - z1[k] };
+			double r2x{ x - x2[k] }, r2y{ y - y2[k] }, r2z{ z - z2[k] };
+
+			double cx{ r1y * r2z - r1z * r2y };
+			double cy{ r1z * r2x - r1x * r2z };
+			double cz{ r1x * r2y - r1y * r2x };
+			double c2{ cx * cx + cy * cy + cz * cz };
+
+			double r1{ std::sqrt(r1x * r1x + r1y * r1y + r1z * r1z) };
+			double r2{ std::sqrt(r2x * r2x + r2y * r2y + r2z * r2z) };
+
+			double r0x{ x2[k] - x1[k] }, r0y{ y2[k] - y1[k] }, r0z{ z2[k] - z1[k] };
+			double r0r1{ r0x * r1x + r0y * r1y + r0z * r1z };
+			double r0r2{ r0x * r2x + r0y * r2y + r0z * r2z };
+
+			bool singular{ r1 < R || r2 < R || c2 < R };
+			double K{ (r0r1 / r1 - r0r2 / r2) * inv_4pi / c2 };
+			K = singular ? 0.0 : K;
+
+			u[k] = K * cx;
+			v[k] = K * cy;
+			w[k] = K * cz;
+		}
+	}
+
+	/// <summary>
+	/// Regularised vortex particles (vortex sticks) in structure-of-arrays
+	/// layout: position, vector strength alpha = G dl and core radius sigma.
+	/// Stored oldest first.
+	/// </summary>
+	struct Particles
+	{
+		std::vector<double> x, y, z;
+		std::vector<double> ax, ay, az;
+		std::vector<double> sigma;
+
+		int size() const { return (int)x.size(); }
+
+		void reserve(int n)
+		{
+			for (std::vector<double>* v : { &x, &y, &z, &ax, &ay, &az, &sigma }) {
+				v->reserve(n);
+			}
+		}
+
+		void clear()
+		{
+			for (std::vector<double>* v : { &x, &y, &z, &ax, &ay, &az, &sigma }) {
+				v->clear();
+			}
+		}
+
+		void add(const double* position, const double* alpha, double core)
+		{
+			x.push_back(position[0]); y.push_back(position[1]); z.push_back(position[2]);
+			ax.push_back(alpha[0]); ay.push_back(alpha[1]); az.push_back(alpha[2]);
+			sigma.push_back(core);
+		}
+
+		void translate(double dx, double dy, double dz)
+		{
+			for (int k = 0; k < size(); k++) { x[k] += dx; y[k] += dy; z[k] += dz; }
+		}
+
+		/// <summary>
+		/// Merges the oldest count particles pairwise (count/2 remain),
+		/// particle k with particle k + stride in each block of 2 stride, so
+		/// particles added in rows of stride merge row with row. Strength is
+		/// summed, the position is the strength weighted mean and the core
+		/// grows to cover both (at most doubling).
+		/// </summary>
+		void mergeOldest(int count, int stride = 1)
+		{
+			stride = std::max(stride, 1);
+			count = std::min(count, size()) / (2 * stride) * (2 * stride);
+			if (count < 2) { return; }
+
+			int out{ 0 };
+			for (int block{ 0 }; block < count; block += 2 * stride)
+			{
+				for (int j{ 0 }; j < stride; j++, out++)
+				{
+					const int k0{ block + j };
+					const int k1{ k0 + stride };
+
+					double w0{ std::sqrt(ax[k0] * ax[k0] + ay[k0] * ay[k0] + az[k0] * az[k0]) };
+					double w1{ std::sqrt(ax[k1] * ax[k1] + ay[k1] * ay[k1] + az[k1] * az[k1]) };
+					double t{ w0 + w1 > 0 ? w1 / (w0 + w1) : 0.5 };
+
+					double d{ std::sqrt(
+						std::pow(x[k1] - x[k0], 2) + std::pow(y[k1] - y[k0], 2) + std::pow(z[k1] - z[k0], 2)) };
+
+					x[out] = x[k0] + t * (x[k1] - x[k0]);
+					y[out] = y[k0] + t * (y[k1] - y[k0]);
+					z[out] = z[k0] + t * (z[k1] - z[k0]);
+					ax[out] = ax[k0] + ax[k1];
+					ay[out] = ay[k0] + ay[k1];
+					az[out] = az[k0] + az[k1];
+					// Core grows to cover the pair, but at most doubles per
+					// merge, so a badly paired merge cannot reach span scale.
+					const double core{ std::max(sigma[k0], sigma[k1]) };
+					sigma[out] = std::max(core, std::min(d, 2 * core));
+				}
+			}
+
+			// Shift the rest down.
+			for (std::vector<double>* v : { &x, &y, &z, &ax, &ay, &az, &sigma }) {
+				v->erase(v->begin() + out, v->begin() + count);
+			}
+		}
+
+		/// <summary>
+		/// Redistributes onto a uniform grid of cell size h: the particles in
+		/// each cell are replaced by one at their strength weighted centroid
+		/// with the summed strength (total vorticity is conserved) and a core
+		/// of at least h. Cells whose strengths cancel are dropped. The order
+		/// of first occurrence, so roughly the age order, is kept. count
+		/// (optional): only the oldest count particles are redistributed and
+		/// the rest follow them unchanged.
+		/// </summary>
+		void redistribute(double h, int count = -1)
+		{
+			const int n{ count < 0 ? size() : std::min(count, size()) };
+			if (h <= 0 || n == 0) { return; }
+
+			// Cells are keyed by their full integer indices, so distant
+			// cells never collide.
+			using Cell = std::array<long long, 3>;
+			struct CellHash {
+				std::size_t operator()(const Cell& c) const {
+					std::uint64_t hash{ 14695981039346656037ull };
+					for (long long i : c) { hash = (hash ^ (std::uint64_t)i) * 1099511628211ull; }
+					return (std::size_t)hash;
+				}
+			};
+			auto cell = [&](double c) { return (long long)std::floor(c / h); };
+
+			std::unordered_map<Cell, int, CellHash> cells;
+			cells.reserve(n);
+
+			Particles out;
+			std::vector<double> weight;
+			for (int k{ 0 }; k < n; k++)
+			{
+				Cell key{ cell(x[k]), cell(y[k]), cell(z[k]) };
+				double w{ std::sqrt(ax[k] * ax[k] + ay[k] * ay[k] + az[k] * az[k]) };
+
+				auto [it, inserted] = cells.try_emplace(key, out.size());
+				if (inserted)
+				{
+					double position[3]{ w * x[k], w * y[k], w * z[k] };
+					double alpha[3]{ ax[k], ay[k], az[k] };
+					out.add(position, alpha, std::max(sigma[k], h));
+					weight.push_back(w);
+					continue;
+				}
+
+				int i{ it->second };
+				out.x[i] += w * x[k]; out.y[i] += w * y[k]; out.z[i] += w * z[k];
+				out.ax[i] += ax[k]; out.ay[i] += ay[k]; out.az[i] += az[k];
+				out.sigma[i] = std::max(out.sigma[i], sigma[k]);
+				weight[i] += w;
+			}
+
+			Particles rest;
+			for (int k{ n }; k < size(); k++)
+			{
+				double position[3]{ x[k], y[k], z[k] };
+				double alpha[3]{ ax[k], ay[k], az[k] };
+				rest.add(position, alpha, sigma[k]);
+			}
+
+			clear();
+			for (int i{ 0 }; i < out.size(); i++)
+			{
+				if (out.ax[i] == 0 && out.ay[i] == 0 && out.az[i] == 0) { continue; }
+
+				double position[3]{ out.x[i] / weight[i], out.y[i] / weight[i], out.z[i] / weight[i] };
+				double alpha[3]{ out.ax[i], out.ay[i], out.az[i] };
+				add(position, alpha, out.sigma[i]);
+			}
+			for (int k{ 0 }; k < rest.size(); k++)
+			{
+				double position[3]{ rest.x[k], rest.y[k], rest.z[k] };
+				double alpha[3]{ rest.ax[k], rest.ay[k], rest.az[k] };
+				add(position, alpha, rest.sigma[k]);
+			}
+		}
+	};
+
+	/// <summary>
+	/// Velocity induced at (x, y, z) by each particle (P2C), written to u, v,
+	/// w (length p.size()). Rosenhead-Moore regularisation:
+	///		u = alpha x r / (4 pi (|r|^2 + sigma^2)^3/2)
+	/// </summary>
+	inline void particleVelocities(
+		const Particles& p, double x, double y, double z,
+		double* __restrict u, double* __restrict v, double* __restrict w
+	)
+	{
+		const int n{ p.size() };
+		const double* __restrict px{ p.x.data() };
+		const double* __restrict py{ p.y.data() };
+		const double* __restrict pz{ p.z.data() };
+		const double* __restrict ax{ p.ax.data() };
+		const double* __restrict ay{ p.ay.data() };
+		const double* __restrict az{ p.az.data() };
+		const double* __restrict sigma{ p.sigma.data() };
+
+		const double inv_4pi{ 1 / (4 * 3.14159265358979323846) };
+
+		for (int k = 0; k < n; k++)
+		{
+			double rx{ x - px[k] }, ry{ y - py[k] }, rz{ z - pz[k] };
+			double r2{ rx * rx + ry * ry + rz * rz + sigma[k] * sigma[k] };
+			double K{ inv_4pi / (r2 * std::sqrt(r2)) };
+
+			u[k] = K * (ay[k] * rz - az[k] * ry);
+			v[k] = K * (az[k] * rx - ax[k] * rz);
+			w[k] = K * (ax[k] * ry - ay[k] * rx);
+		}
+	}
+
+	/// <summary>
+	/// Velocity induced by particles [first, last) at n targets, added to u,
+	/// v, w (P2P). The target loop is innermost, so it vectorises without
+	/// reordering the sums. Same kernel as particleVelocities.
+	/// </summary>
+	inline void particleInteractions(
+		const Particles& p, int first, int last,
+		const double* __restrict tx, const double* __restrict ty, const double* __restrict tz, int n,
+		double* __restrict u, double* __restrict v, double* __restrict w
+	)
+	{
+		const double inv_4pi{ 1 / (4 * 3.14159265358979323846) };
+
+		for (int k = first; k < last; k++)
+		{
+			const double px{ p.x[k] }, py{ p.y[k] }, pz{ p.z[k] };
+			const double ax{ p.ax[k] }, ay{ p.ay[k] }, az{ p.az[k] };
+			const double sigma2{ p.sigma[k] * p.sigma[k] };
+
+			for (int i = 0; i < n; i++)
+			{
+				double rx{ tx[i] - px }, ry{ ty[i] - py }, rz{ tz[i] - pz };
+				double r2{ rx * rx + ry * ry + rz * rz + sigma2 };
+				double K{ inv_4pi / (r2 * std::sqrt(r2)) };
+
+				u[i] += K * (ay * rz - az * ry);
+				v[i] += K * (az * rx - ax * rz);
+				w[i] += K * (ax * ry - ay * rx);
+			}
+		}
+	}
+
+}
@@ -1,119 +1,353 @@
 ﻿#include <pch.h>
 
 #include <vlm.hpp>
+#include <solvecache.hpp>
+#include <utils/hash.hpp>
 
-Vlm::Vlm(Plane* plane)
+Vlm::Vlm(Plane* plane, bool verbose)
 	: plane{ plane }
+	, verbose{ verbose }
 {
 
 }
 
-// Calculates induced velocity on a point due to a line vortex element.
-std::array<double,3> Vlm::lineVortex(
-	double x, double y, double z, double x1, double y1, double z1,
-	double x2, double y2, double z2, double vorticity, double R
+/// <summary>
+/// Influence (a, factorised in place) and downwash (b) matrices are N x N.
+/// The rest is O(N).
+/// </summary>
+std::size_t Vlm::memoryEstimate(int nPanels)
+{
+	std::size_t N{ (std::size_t)nPanels };
+	return 2 * N * N * sizeof(double) + 64 * N * sizeof(double);
+}
+
+/// <summary>
+/// Solves vortex strength at each collocation point on the mesh:
+///		[a_ij][gamma_i] = -V_inf . n_i
+///			where a_ij = (u,v,w)_ij . n_i
+/// 
+/// See 'Low Speed Aerodynamics...' - Katz & Plotkin for more detail.
+/// </summary>
+/// <param name="Qinf">Absolute freestream velocity</param>
+/// <param name="alpha">Angle of attack (deg)</param>
+/// <param name="beta">Angle of slideslip (deg)</param>
+/// <param name="warmStart">Solved Vlm on a near-identical mesh. Its
+/// factorisation preconditions an iterative solve starting from its
+/// vorticity. Falls back to a direct solve if this does not converge.</param>
+void Vlm::runHorseshoe(
+	double Qinf, double alpha, double beta, double atmosphereDensity,
+	const Vlm* warmStart
+)
+{
+	setFreestream(Qinf, alpha, beta, atmosphereDensity);
+
+	upstream.clear();
+	solve(horseshoeLattice(), warmStart);
+}
+
+/// <summary>
+/// Horseshoe solve by GMRES from an initial guess, e.g. the solution of a
+/// coarser mesh interpolated onto this one. Falls back to a direct solve if
+/// GMRES does not converge.
+/// </summary>
+void Vlm::runHorseshoe(
+	double Qinf, double alpha, double beta, double atmosphereDensity,
+	const nc::NdArray<double>& initialGuess
+)
+{
+	setFreestream(Qinf, alpha, beta, atmosphereDensity);
+
+	upstream.clear();
+	solve(horseshoeLattice(), nullptr, &initialGuess);
+}
+
+/// <summary>
+/// Vortex ring lattice solve. Ring leading edges lie on the panel quarter
+/// chord and trailing edges on the next panel's quarter chord; the trailing
+/// edge row sheds a steady wake, so those rings have semi-infinite legs in
+/// place of a rear edge. Each panel carries its ring strength; the bound
+/// vortex strength is the difference to the ring upstream.
+/// 
+/// See 'Low Speed Aerodynamics...' - Katz & Plotkin, 12.3.
+/// </summary>
+void Vlm::runRing(
+	double Qinf, double alpha, double beta, double atmosphereDensity,
+	const Vlm* warmStart
+)
+{
+	setFreestream(Qinf, alpha, beta, atmosphereDensity);
+
+	solve(ringLattice(), warmStart);
+}
+
+/// <summary>
+/// Assembles and solves the given lattice, keeping the factorisation unless
+/// the system was solved iteratively from an initial guess.
+/// </summary>
+void Vlm::solve(
+	const Lattice& lattice, const Vlm* warmStart, const nc::NdArray<double>* initialGuess
 )
 {
-	std::array<double, 3> inducedVelocity{ 0,0,0 };
+	const int N{ plane->mesh->nPanels };
+	nc::NdArray<double> RHS = nc::zeros<double>(N, 1);
 
-	double r1x2_x{ (y - y1) * (z - z2) - (z - z1) * (y - y2) };
-	double r1x2_y{ -(x - x1) * (z - z2) - (z - z1) * (x - x2) };
-	double r1x2_z{ (x - x1) * (y - y2) - (y - y1) * (x - x2) };
+	// Cached factors skip assembly and factorisation.
+	const bool cacheable{ solveCache != nullptr && initialGuess == nullptr };
+	const std::uint64_t key{ cacheable ? influenceKey(lattice) : 0 };
+	solveCached = cacheable && solveCache->load(key, N, lu, b);
+	if (solveCached)
+	{
+		int i{ 0 };
+		for (Panel& panel : *plane->mesh) {
+			const double* n{ panel.normal };
+			RHS[i++] = -(Qinf_vec[0] * n[0] + Qinf_vec[1] * n[1] + Qinf_vec[2] * n[2]);
+		}
 
-	double r1x2_mod2{ std::pow(r1x2_x,2) + std::pow(r1x2_y,2) + std::pow(r1x2_z,2) };
+		refineIterations = -1;
+		vorticity = RHS;
+		lu.solve(vorticity.data());
 
-	double r1_mod{ 
-		std::sqrt(std::pow(x - x1,2) + std::pow(y - y1,2) + std::pow(z - z1,2)) };
-	double r2_mod{ 
-		std::sqrt(std::pow(x - x2,2) + std::pow(y - y2,2) + std::pow(z - z2,2)) };
+		calcLoads();
+		return;
+	}
+
+	std::vector<double> a((size_t)N * N);
+	b = nc::zeros<double>(N, N);
 
-	// Singularity condition:
-	// If point lies on vortex, induced velocities = 0
-	if (r1_mod < R || r2_mod < R || r1x2_mod2 < R)
+	assemble(lattice, a, RHS);
+
+	if (initialGuess != nullptr && iterate(a, RHS, *initialGuess))
 	{
-		return inducedVelocity;
+		lu = utils::LU{};
 	}
+	else if (initialGuess != nullptr || warmStart == nullptr || !refine(a, RHS, *warmStart))
+	{
+		if (verbose) { std::cout << "Solving influence matrix..." << '\n'; }
 
+		refineIterations = -1;
+		lu = utils::LU{ std::move(a), N };
+		vorticity = RHS;
+		lu.solve(vorticity.data());
 
-	double r0dotr1{ (x2 - x1) * (x - x1) + (y2 - y1) * (y - y1) + (z2 - z1) * (z - z1) };
-	double r0dotr2{ (x2 - x1) * (x - x2) + (y2 - y1) * (y - y2) + (z2 - z1) * (z - z2) };
+		if (cacheable) { solveCache->store(key, lu, b); }
+	}
 
-	double K{
-		(vorticity / (4 * nc::constants::pi * r1x2_mod2)) * 
-		((r0dotr1 / r1_mod) - (r0dotr2 / r2_mod))
-	};
+	calcLoads();
+}
 
-	inducedVelocity[0] = K * r1x2_x;
-	inducedVelocity[1] = K * r1x2_y;
-	inducedVelocity[2] = K * r1x2_z;
+/// <summary>
+/// Solve cache key: everything the influence and downwash matrices depend
+/// on - the lattice segments and their strength columns (which carry the
+/// wake geometry and so alpha), the collocation points and normals, and the
+/// vortex core radius.
+/// </summary>
+std::uint64_t Vlm::influenceKey(const Lattice& lattice) const
+{
+	const int N{ plane->mesh->nPanels };
+	std::uint64_t hash{ utils::fnv1a(&N, sizeof(N)) };
+	hash = utils::fnv1a(&R, sizeof(R), hash);
+
+	const utils::Segments& s{ lattice.segments };
+	for (const std::vector<double>* v : { &s.x1, &s.y1, &s.z1, &s.x2, &s.y2, &s.z2 }) {
+		hash = utils::fnv1a(*v, hash);
+	}
+	hash = utils::fnv1a(lattice.columns, hash);
+	hash = utils::fnv1a(lattice.signs, hash);
+	hash = utils::fnv1a(lattice.trailing, hash);
+	hash = utils::fnv1a(lattice.legs, hash);
+
+	for (const Panel& panel : *plane->mesh) {
+		hash = utils::fnv1a(panel.cp, sizeof(panel.cp), hash);
+		hash = utils::fnv1a(panel.normal, sizeof(panel.normal), hash);
+	}
 
-	return inducedVelocity;
+	return hash;
 }
 
-// Calculates velocities by each line vortex in the trailing vortex
-std::array<std::array<double, 3>, 2> Vlm::horseshoeVortex(
-	double x, double y, double z, double xA, double yA, double zA,
-	double xB, double yB, double zB, double xC, double yC, double zC,
-	double xD, double yD, double zD, double vorticity, double R
-)
+void Vlm::setFreestream(double Qinf, double alpha, double beta, double atmosphereDensity)
 {
-	// Induced velocities by each line vortex in the trailing vortex
-	std::array<double, 3> q1{ lineVortex(x,y,z,xA,yA,zA,xB,yB,zB,vorticity,R) };
-	std::array<double, 3> q2{ lineVortex(x,y,z,xB,yB,zB,xC,yC,zC,vorticity,R) };
-	std::array<double, 3> q3{ lineVortex(x,y,z,xC,yC,zC,xD,yD,zD,vorticity,R) };
+	this->Qinf = Qinf;
+	rho = atmosphereDensity;
+	alpha_rad = nc::deg2rad(alpha);
+	beta_rad = nc::deg2rad(beta);
 
-	// Induced velocity by horseshoe vortex on point P
-	std::array<double, 3> q{
-		q1[0] + q2[0] + q3[0],
-		q1[1] + q2[1] + q3[1],
-		q1[2] + q2[2] + q3[2]
+	Qinf_vec = Qinf * nc::NdArray<double>{
+		nc::cos(alpha_rad)* nc::cos(beta_rad),
+		-nc::sin(beta_rad),
+		nc::sin(alpha_rad)* nc::cos(beta_rad)
 	};
+}
+
+/// <summary>
+/// Horseshoe per panel: trailing leg A-B from far downstream, bound vortex
+/// B-C on the quarter chord, trailing leg C-D back downstream.
+/// </summary>
+Vlm::Lattice Vlm::horseshoeLattice() const
+{
+	const int N{ plane->mesh->nPanels };
+	const double xA{ 10 * plane->b_ref };	// downstream trailing vertices
+	const double zA{ xA * std::sin(alpha_rad) };
+
+	Lattice lattice;
+	lattice.segments.reserve(3 * N);
 
-	// Induced downwash velocity by horseshoe vortex on point P
-	std::array<double, 3> q_{
-		q1[0] + q3[0],
-		q1[1] + q3[1],
-		q1[2] + q3[2]
+	auto add = [&](const double* P1, const double* P2, int column, bool trailing) {
+		lattice.segments.add(P1, P2);
+		lattice.columns.push_back({ column, N });
+		lattice.signs.push_back({ 1, 0 });
+		lattice.trailing.push_back(trailing);
 	};
 
-	return { q, q_ };
+	int j{ 0 };
+	for (Panel& p : *plane->mesh)
+	{
+		const double* B{ p.B };
+		const double* C{ p.C };
+		double A[3]{ xA, B[1], zA };
+		double D[3]{ xA, C[1], zA };
+
+		add(A, B, j, true);
+		add(B, C, j, false);
+		add(C, D, j, true);
+
+		j++;
+	}
+
+	return lattice;
 }
 
 /// <summary>
-/// Solves vortex strength at each collocation point on the mesh:
-///		[a_ij][gamma_i] = -V_inf . n_i
-///			where a_ij = (u,v,w)_ij . n_i
-/// 
-/// See 'Low Speed Aerodynamics...' - Katz & Plotkin for more detail.
+/// Vortex ring lattice. Nodes are the mesh points shifted a quarter of the
+/// local panel chord downstream (the last row a quarter chord behind the
+/// trailing edge). Each lattice edge is stored once with the strengths of
+/// the two rings sharing it:
+///		spanwise edge (i,j)->(i,j+1):	+G(i,j) - G(i-1,j)
+///		chordwise edge (i,j)->(i+1,j):	+G(i,j-1) - G(i,j)
+///		wake leg (n,j)->downstream:		+G(n-1,j-1) - G(n-1,j)
+/// Also fills upstream (ring ahead of each panel, -1 on the leading edge).
 /// </summary>
-/// <param name="Qinf">Absolute freestream velocity</param>
-/// <param name="alpha">Angle of attack (deg)</param>
-/// <param name="beta">Angle of slideslip (deg)</param>
-void Vlm::runHorseshoe(double Qinf, double alpha, double beta, double atmosphereDensity)
+/// <param name="wakeStep">If given, the trailing edge rings are closed
+/// this far downstream (one unsteady wake row) instead of shedding a steady
+/// semi-infinite wake.</param>
+/// <param name="trailingEdges">If given, receives the trailing edge node
+/// row ((m+1) x 3) of each wing.</param>
+Vlm::Lattice Vlm::ringLattice(
+	const double* wakeStep, std::vector<std::vector<double>>* trailingEdges
+)
 {
-	this->Qinf = Qinf;
-	rho = atmosphereDensity;
-	double alpha_rad{ nc::deg2rad(alpha) };
-	double beta_rad{ nc::deg2rad(beta) };
+	const int N{ plane->mesh->nPanels };
+	const double xA{ 10 * plane->b_ref };
+	const double zA{ xA * std::sin(alpha_rad) };
 
-	double b_ref{ plane->b_ref };
+	Lattice lattice;
+	lattice.segments.reserve(2 * N + 4 * plane->n_wings);
+	upstream.assign(N, -1);
 
-	const nc::NdArray<double> Qinf_vec{
-		Qinf *
-		nc::NdArray<double>{
-			nc::cos(alpha_rad)* nc::cos(beta_rad),
-			-nc::sin(beta_rad),
-			nc::sin(alpha_rad)* nc::cos(beta_rad)
-		}
+	auto add = [&](const double* P1, const double* P2,
+		int column0, double sign0, int column1, double sign1, bool trailing)
+	{
+		// Strengths outside the lattice go to the dummy column N.
+		if (column0 < 0) { column0 = N; sign0 = 0; }
+		if (column1 < 0) { column1 = N; sign1 = 0; }
+
+		lattice.segments.add(P1, P2);
+		lattice.columns.push_back({ column0, column1 });
+		lattice.signs.push_back({ sign0, sign1 });
+		lattice.trailing.push_back(trailing);
 	};
 
+	int offset{ 0 };
+	for (int w{ 0 }; w != plane->n_wings; w++)
+	{
+		const Wing& wing{ *plane->wings[w] };
+		const int n{ wing.n };
+		const int m{ wing.m_sum };
+		std::span<const double> points{ plane->mesh->at(w)->getPoints() };
+
+		// Lattice nodes, (n+1) x (m+1).
+		std::vector<double> nodes(3 * (size_t)(n + 1) * (m + 1));
+		for (int i{ 0 }; i <= n; i++)
+		{
+			for (int j{ 0 }; j <= m; j++)
+			{
+				int row{ i == n ? n - 1 : i };	// panel row the node is set from
+				const double* P_le{ points.data() + 3 * (j + (m + 1) * row) };
+				const double* P_te{ points.data() + 3 * (j + (m + 1) * (row + 1)) };
+				const double* P{ i == n ? P_te : P_le };
+
+				double* node{ &nodes[3 * (j + (m + 1) * i)] };
+				for (int k{ 0 }; k != 3; k++) {
+					node[k] = P[k] + 0.25 * (P_te[k] - P_le[k]);
+				}
+			}
+		}
+
+		auto node = [&](int i, int j) { return &nodes[3 * (j + (m + 1) * i)]; };
+		auto ring = [&](int i, int j) {
+			return (i < 0 || i >= n || j < 0 || j >= m) ? -1 : offset + j + m * i;
+		};
+
+		for (int i{ 0 }; i != n; i++)
+		{
+			for (int j{ 0 }; j != m; j++)
+			{
+				add(node(i, j), node(i, j + 1), ring(i, j), 1, ring(i - 1, j), -1, false);
+				upstream[ring(i, j)] = ring(i - 1, j);
+			}
+			for (int j{ 0 }; j <= m; j++)
+			{
+				add(node(i, j), node(i + 1, j), ring(i, j - 1), 1, ring(i, j), -1, true);
+			}
+		}
+
+		if (wakeStep == nullptr)
+		{
+			for (int j{ 0 }; j <= m; j++)
+			{
+				double D[3]{ xA, node(n, j)[1], zA };
+				lattice.legs.push_back(lattice.segments.size());
+				add(node(n, j), D, ring(n - 1, j - 1), 1, ring(n - 1, j), -1, true);
+			}
+		}
+		else
+		{
+			// Trailing edge rings closed by the wake row shed this step.
+			std::vector<double> shed(3 * (size_t)(m + 1));
+			for (int j{ 0 }; j <= m; j++) {
+				for (int k{ 0 }; k != 3; k++) { shed[3 * j + k] = node(n, j)[k] + wakeStep[k]; }
+			}
+			for (int j{ 0 }; j <= m; j++) {
+				add(node(n, j), &shed[3 * j], ring(n - 1, j - 1), 1, ring(n - 1, j), -1, true);
+			}
+			for (int j{ 0 }; j != m; j++) {
+				add(&shed[3 * j], &shed[3 * (j + 1)], ring(n - 1, j), -1, -1, 0, false);
+			}
+		}
+
+		if (trailingEdges != nullptr) {
+			trailingEdges->emplace_back(node(n, 0), node(n, 0) + 3 * (m + 1));
+		}
+
+		offset += n * m;
+	}
+
+	return lattice;
+}
+
+/// <summary>
+/// Builds the influence matrix (a, row-major), the wake downwash matrix (b)
+/// and the freestream right hand side for a lattice. Rows are split across
+/// nThreads threads (see setThreads); per collocation point every unique segment is evaluated once
+/// (plus its mirror image about y = 0) and then scattered to the vortex
+/// strengths it belongs to.
+/// </summary>
+void Vlm::assemble(const Lattice& lattice, std::vector<double>& a, nc::NdArray<double>& RHS)
+{
 	const int N{ plane->mesh->nPanels };
-	nc::NdArray<double> a = nc::zeros<double>(N, N);
-	nc::NdArray<double> b = nc::zeros<double>(N, N);
-	nc::NdArray<double> RHS = nc::zeros<double>(N, 1);
+	const int S{ lattice.segments.size() };
 
 	// Progress bar setup
-	indicators::show_console_cursor(false);
+	if (verbose) { indicators::show_console_cursor(false); }
 
 	indicators::ProgressBar bar{
 		indicators::option::BarWidth{30},
@@ -129,75 +363,198 @@ void Vlm::runHorseshoe(double Qinf, double alpha, double beta, double atmosphere
 		indicators::option::FontStyles{
 			std::vector<indicators::FontStyle>{indicators::FontStyle::bold}}
 	};
+	std::atomic<int> rows_done{ 0 };
+	const int progress_step{ std::max(N / 30, 1) };
 
-	// Collocation point loop
-	int i{ 0 };
-	float progress{ 0.0f };
-	for (Panel& p0 : *plane->mesh)
-	{	
-		RHS(0, i) = nc::dot(-Qinf_vec, p0.normal)[0];
+	double* b_data{ b.data() };
 
-		double x{ p0.cp(0,0) };
-		double y{ p0.cp(0,1) };
-		double z{ p0.cp(0,2) };
+	utils::parallelFor(N, [&](int first, int last)
+	{
+		std::vector<double> u(S), v(S), w(S);
+		std::vector<double> um(S), vm(S), wm(S);
+		std::vector<double> row_a(N + 1), row_b(N + 1);	// + dummy column
 
-		// Vortex element loop
-		int j{ 0 };
-		for (Panel& p1 : *plane->mesh)
+		// Rows are panels by global index.
+		MultiMesh::PanelIterator panel{ plane->mesh.get(), first };
+		for (int i{ first }; i != last; i++, ++panel)
 		{
-			double xB{ p1.B(0,0) };
-			double yB{ p1.B(0,1) };
-			double zB{ p1.B(0,2) };
+			const double* n{ panel->normal };
+			double x{ panel->cp[0] };
+			double y{ panel->cp[1] };
+			double z{ panel->cp[2] };
 
-			double xC{ p1.C(0,0) };
-			double yC{ p1.C(0,1) };
-			double zC{ p1.C(0,2) };
+			RHS[i] = -(Qinf_vec[0] * n[0] + Qinf_vec[1] * n[1] + Qinf_vec[2] * n[2]);
 
-			double xA{ 10 * b_ref };	// downstream trailing vertex
-			double xD{ 10 * b_ref };	// "
+			utils::lineVortices(lattice.segments, x, y, z, R, u.data(), v.data(), w.data());
+			utils::lineVortices(lattice.segments, x, -y, z, R, um.data(), vm.data(), wm.data());
 
-			double yA{ yB };
-			double yD{ yC };
+			std::fill(row_a.begin(), row_a.end(), 0.0);
+			std::fill(row_b.begin(), row_b.end(), 0.0);
 
-			double zA{ xA * nc::sin(alpha_rad) };
-			double zD{ xD * nc::sin(alpha_rad) };
+			for (int s{ 0 }; s != S; s++)
+			{
+				double q_n{
+					(u[s] + um[s]) * n[0] + (v[s] - vm[s]) * n[1] + (w[s] + wm[s]) * n[2] };
 
-			std::array<std::array<double, 3>, 2> Uind{
-				horseshoeVortex(x,y,z,xA,yA,zA,xB,yB,zB,xC,yC,zC,xD,yD,zD,1,R)
-			};
+				const std::array<int, 2>& columns{ lattice.columns[s] };
+				const std::array<double, 2>& signs{ lattice.signs[s] };
 
-			std::array<std::array<double, 3>, 2> Uind_mirror{
-				horseshoeVortex(x,-y,z,xA,yA,zA,xB,yB,zB,xC,yC,zC,xD,yD,zD,1,R)
-			};
+				row_a[columns[0]] += signs[0] * q_n;	// influence coefficient matrix
+				row_a[columns[1]] += signs[1] * q_n;
 
-			nc::NdArray<double> q{
-				Uind[0][0] + Uind_mirror[0][0],
-				Uind[0][1] - Uind_mirror[0][1],
-				Uind[0][2] + Uind_mirror[0][2]
-			};
-			nc::NdArray<double> q_{
-				Uind[1][0] + Uind_mirror[1][0],
-				Uind[1][1] - Uind_mirror[1][1],
-				Uind[1][2] + Uind_mirror[1][2]
-			};
+				if (lattice.trailing[s]) {	// normal component of wake induced downwash
+					row_b[columns[0]] += signs[0] * q_n;
+					row_b[columns[1]] += signs[1] * q_n;
+				}
+			}
 
-			a(i, j) = nc::dot(q, p0.normal)[0];	// influence coefficient matrix
-			b(i, j) = nc::dot(q_, p0.normal)[0];// normal component of wake induced downwash
+			std::copy(row_a.begin(), row_a.begin() + N, a.begin() + (size_t)i * N);
+			std::copy(row_b.begin(), row_b.begin() + N, b_data + (size_t)i * N);
 
-			j++;
+			int done{ ++rows_done };
+			if (verbose && (done % progress_step == 0 || done == N)) {
+				bar.set_progress(100.0f * done / N);
+			}
 		}
+	}, nThreads);
 
-		i++;
-		if ((float)i/N >= progress) {
-			progress += (1.0f / 30.0f);
-			bar.set_progress(progress*100);
+	if (verbose) { indicators::show_console_cursor(true); }
+}
+
+/// <summary>
+/// Preconditioned iterative refinement:
+///		x_k+1 = x_k + LU_0^-1 (RHS - a x_k)
+/// where LU_0 is the factorisation of a nearby (nominal) system. Converges in
+/// a handful of O(N^2) iterations when a differs only slightly from the
+/// nominal matrix.
+/// </summary>
+/// <returns>true if converged. vorticity holds the solution.</returns>
+bool Vlm::refine(
+	const std::vector<double>& a, const nc::NdArray<double>& RHS, const Vlm& warmStart
+)
+{
+	const int N{ plane->mesh->nPanels };
+	if (warmStart.lu.size() != N) { return false; }
+
+	double RHS_norm{ nc::norm(RHS)[0] };
+	if (RHS_norm == 0) { RHS_norm = 1; }
+
+	if (&warmStart != this) { vorticity = warmStart.vorticity; }
+	std::vector<double> r(N);
+
+	double r_prev{ std::numeric_limits<double>::max() };
+	for (int k{ 0 }; k != maxRefineIterations; k++)
+	{
+		// Residual
+		double r_norm2{ 0 };
+		for (int i{ 0 }; i != N; i++)
+		{
+			const double* a_i{ &a[(size_t)i * N] };
+			double s{ RHS[i] };
+			for (int j{ 0 }; j != N; j++) { s -= a_i[j] * vorticity[j]; }
+			r[i] = s;
+			r_norm2 += s * s;
+		}
+
+		double r_norm{ std::sqrt(r_norm2) / RHS_norm };
+		if (r_norm < refineTolerance) {
+			refineIterations = k;
+			return true;
 		}
-		
+		if (r_norm > r_prev) { break; }	// diverging - perturbation too large
+		r_prev = r_norm;
+
+		warmStart.lu.solve(r.data());
+		for (int i{ 0 }; i != N; i++) { vorticity[i] += r[i]; }
 	}
-	indicators::show_console_cursor(true);
 
-	std::cout << "Solving influence matrix..." << '\n';
-	nc::NdArray<double> vorticity{ nc::linalg::solve(a,RHS) };
+	refineIterations = -1;
+	return false;
+}
+
+/// <summary>
+/// GMRES on the assembled system from an initial guess. The preconditioner
+/// is block Jacobi over spanwise strips: each strip's chordwise panels are
+/// strongly coupled, so their block is factorised (n x n per strip). Matrix
+/// products are split across threads by row.
+/// </summary>
+/// <returns>true if converged (false if a strip block is singular).
+/// vorticity holds the solution.</returns>
+bool Vlm::iterate(
+	const std::vector<double>& a, const nc::NdArray<double>& RHS,
+	const nc::NdArray<double>& initialGuess
+)
+{
+	const int N{ plane->mesh->nPanels };
+	if ((int)initialGuess.size() != N) { return false; }
+
+	// Global panel indices of each strip, leading edge first.
+	std::vector<std::vector<int>> blocks;
+	int offset{ 0 };
+	for (const std::unique_ptr<Wing>& wing : plane->wings)
+	{
+		for (int j{ 0 }; j != wing->m_sum; j++)
+		{
+			std::vector<int>& block{ blocks.emplace_back() };
+			for (int i{ 0 }; i != wing->n; i++) { block.push_back(offset + j + wing->m_sum * i); }
+		}
+		offset += wing->n * wing->m_sum;
+	}
+
+	std::vector<utils::LU> block_lu;
+	for (const std::vector<int>& block : blocks)
+	{
+		const int n{ (int)block.size() };
+		std::vector<double> a_block((size_t)n * n);
+		for (int r{ 0 }; r != n; r++) {
+			for (int c{ 0 }; c != n; c++) { a_block[(size_t)r * n + c] = a[(size_t)block[r] * N + block[c]]; }
+		}
+		// A singular strip block just means no iterative solve; the caller
+		// falls back to the direct solve.
+		try {
+			block_lu.emplace_back(std::move(a_block), n);
+		}
+		catch (const std::runtime_error&) {
+			return false;
+		}
+	}
+
+	auto matVec = [&](const double* x, double* y) {
+		utils::parallelFor(N, [&](int first, int last) {
+			for (int i{ first }; i != last; i++) {
+				const double* a_i{ &a[(size_t)i * N] };
+				double s{ 0 };
+				for (int j{ 0 }; j != N; j++) { s += a_i[j] * x[j]; }
+				y[i] = s;
+			}
+		}, nThreads);
+	};
+	auto precond = [&](const double* x, double* y) {
+		std::vector<double> x_block;
+		for (int k{ 0 }; k != (int)blocks.size(); k++)
+		{
+			x_block.clear();
+			for (int i : blocks[k]) { x_block.push_back(x[i]); }
+			block_lu[k].solve(x_block.data());
+			for (int r{ 0 }; r != (int)blocks[k].size(); r++) { y[blocks[k][r]] = x_block[r]; }
+		}
+	};
+
+	vorticity = initialGuess;
+	vorticity.reshape(N, 1);
+
+	utils::GmresResult result{ utils::gmres(
+		N, matVec, precond, RHS.data(), vorticity.data(), gmresTolerance, maxGmresIterations) };
+
+	refineIterations = result.converged ? result.iterations : -1;
+	return result.converged;
+}
+
+/// <summary>
+/// Panel forces from the solved vorticity (Kutta-Joukowski).
+/// </summary>
+void Vlm::calcLoads()
+{
 	nc::NdArray<double> w_ind{ nc::matmul(b,vorticity) };
 
 	// Aero force computation
@@ -206,11 +563,15 @@ void Vlm::runHorseshoe(double Qinf, double alpha, double beta, double atmosphere
 	double Di{ 0 };
 	for (Panel& p : *plane->mesh)
 	{
-		p.vorticity = vorticity[k];
+		// Bound vortex strength - ring lattices subtract the ring ahead.
+		double gamma{ vorticity[k] };
+		if (!upstream.empty() && upstream[k] >= 0) { gamma -= vorticity[upstream[k]]; }
+
+		p.vorticity = gamma;
 		p.w_ind = w_ind(k, 0);
 
-		p.dL = rho * this->Qinf * vorticity(k, 0) * p.dy;
-		p.dDi = -rho * w_ind(k, 0) * vorticity(k, 0) * p.dy;
+		p.dL = rho * this->Qinf * gamma * p.dy;
+		p.dDi = -rho * w_ind(k, 0) * gamma * p.dy;
 
 		L += p.dL;
 		Di += p.dDi;
@@ -221,3 +582,392 @@ void Vlm::runHorseshoe(double Qinf, double alpha, double beta, double atmosphere
 	CL = L / (0.5 * rho * plane->S_ref * std::pow(Qinf, 2));
 	CDi = Di / (0.5 * rho * plane->S_ref * std::pow(Qinf, 2));
 }
+
+/// <summary>
+/// Groups panels into spanwise strips (one per spanwise panel column of each
+/// wing) and assigns each strip the polars of the sections either side of
+/// it, weighted by spanwise position.
+/// </summary>
+void Vlm::buildStrips()
+{
+	strips.clear();
+
+	int offset{ 0 };
+	for (int w{ 0 }; w != plane->n_wings; w++)
+	{
+		Wing& wing{ *plane->wings[w] };
+		std::span<Panel> panels{ plane->mesh->at(w)->getPanels() };
+
+		int j{ 0 };
+		for (int s{ 1 }; s != wing.sections.size(); s++)
+		{
+			const Section& section_prev{ wing.sections[s - 1] };
+			const Section& section_curr{ wing.sections[s] };
+
+			for (int k{ 0 }; k != section_curr.m; k++, j++)
+			{
+				Strip strip;
+				for (int i{ 0 }; i != wing.n; i++) {
+					strip.panels.push_back(offset + j + wing.m_sum * i);
+				}
+
+				// Chord between leading and trailing edge midpoints.
+				std::array<const double*, 4> le{ panels[j].getCorners() };
+				std::array<const double*, 4> te{
+					panels[j + wing.m_sum * (wing.n - 1)].getCorners() };
+
+				double chord2{ 0 };
+				for (int d{ 0 }; d != 3; d++) {
+					chord2 += std::pow(0.5 * (te[3][d] + te[2][d]) - 0.5 * (le[0][d] + le[1][d]), 2);
+				}
+				strip.chord = std::sqrt(chord2);
+				strip.dy = panels[j].dy;
+
+				// Strip midpoint between the sections, in the panel spacing.
+				double t{ 0.5 * (section_curr.spanwise(k, section_curr.m)
+					+ section_curr.spanwise(k + 1, section_curr.m)) };
+				strip.polars = { section_prev.polar.get(), section_curr.polar.get() };
+				strip.weights = { 1 - t, t };
+
+				// Single polar - use it across the whole segment.
+				if (strip.polars[0] == nullptr) { strip.weights = { 0, 1 }; }
+				if (strip.polars[1] == nullptr) { strip.weights = { 1, 0 }; }
+
+				strips.push_back(strip);
+			}
+		}
+
+		offset += (int)panels.size();
+	}
+}
+
+/// <summary>
+/// Strip theory viscous correction (alpha-correction / decambering method,
+/// see van Dam et al. and Gallay & Laurendeau). Each strip is given an angle
+/// correction dalpha that rotates its onset velocity. Per iteration:
+///		cl_inv = 2 Gamma_strip / (Qinf c)
+///		alpha_eff = cl_inv / 2pi - dalpha + alpha_0l
+///		cl_visc = polar(alpha_eff)
+///		dalpha += relaxation * (cl_visc - cl_inv) / 2pi
+/// until cl_inv matches cl_visc on every strip. The influence matrix does not
+/// change, so each iteration is an RHS update and one solve against the
+/// factorisation from runHorseshoe. Strips without a polar stay inviscid.
+/// </summary>
+void Vlm::runViscous(
+	double Qinf, double alpha, double beta, double atmosphereDensity,
+	int maxIterations, double tolerance, double relaxation
+)
+{
+	runHorseshoe(Qinf, alpha, beta, atmosphereDensity);
+	buildStrips();
+
+	const int N{ plane->mesh->nPanels };
+	const int n_strips{ (int)strips.size() };
+	const double two_pi{ 2 * nc::constants::pi };
+
+	// Panel normals and owning strip.
+	std::vector<double> normals(3 * (size_t)N);
+	std::vector<int> panel_strip(N, -1);
+	int k{ 0 };
+	for (Panel& p : *plane->mesh)
+	{
+		normals[3 * k] = p.normal[0];
+		normals[3 * k + 1] = p.normal[1];
+		normals[3 * k + 2] = p.normal[2];
+		k++;
+	}
+
+	// Polar lookups are grouped per polar so each iteration is one
+	// vectorised lookup per distinct polar.
+	struct PolarGroup {
+		const Polar* polar;
+		std::vector<int> strips;
+		std::vector<double> weights;
+		std::vector<double> alpha, cl, cd;
+	};
+	std::vector<PolarGroup> groups;
+
+	std::vector<double> alpha_0l(n_strips, 0);
+	std::vector<double> alpha_stall(n_strips, 0);
+	std::vector<bool> corrected(n_strips, false);
+
+	for (int s{ 0 }; s != n_strips; s++)
+	{
+		Strip& strip{ strips[s] };
+		for (int i : strip.panels) { panel_strip[i] = s; }
+
+		for (int side{ 0 }; side != 2; side++)
+		{
+			const Polar* polar{ strip.polars[side] };
+			double weight{ strip.weights[side] };
+			if (polar == nullptr || weight == 0) { continue; }
+
+			corrected[s] = true;
+			alpha_0l[s] += weight * nc::deg2rad(polar->getZeroLiftAlpha());
+			alpha_stall[s] += weight * polar->getStallAlpha();
+
+			auto group{ std::find_if(groups.begin(), groups.end(),
+				[&](const PolarGroup& g) { return g.polar == polar; }) };
+			if (group == groups.end()) {
+				groups.push_back(PolarGroup{ polar });
+				group = groups.end() - 1;
+			}
+			group->strips.push_back(s);
+			group->weights.push_back(weight);
+		}
+	}
+	for (PolarGroup& g : groups) {
+		g.alpha.resize(g.strips.size());
+		g.cl.resize(g.strips.size());
+		g.cd.resize(g.strips.size());
+	}
+
+	std::vector<double> dalpha(n_strips, 0);
+	std::vector<double> cl_inv(n_strips, 0);
+	std::vector<double> alpha_eff(n_strips, 0);
+	std::vector<double> cl_visc(n_strips, 0);
+	std::vector<double> cd_visc(n_strips, 0);
+	std::vector<double> cos_da(n_strips + 1, 1);	// last entry: uncorrected
+	std::vector<double> sin_da(n_strips + 1, 0);
+
+	const double Vx{ Qinf_vec[0] };
+	const double Vy{ Qinf_vec[1] };
+	const double Vz{ Qinf_vec[2] };
+
+	viscousConverged = false;
+	for (viscousIterations = 1; viscousIterations <= maxIterations; viscousIterations++)
+	{
+		// RHS with each strip's onset rotated by its alpha correction.
+		for (int s{ 0 }; s != n_strips; s++) {
+			cos_da[s] = std::cos(dalpha[s]);
+			sin_da[s] = std::sin(dalpha[s]);
+		}
+		for (int i{ 0 }; i != N; i++)
+		{
+			int s{ panel_strip[i] < 0 ? n_strips : panel_strip[i] };
+			double vx{ Vx * cos_da[s] - Vz * sin_da[s] };
+			double vz{ Vx * sin_da[s] + Vz * cos_da[s] };
+
+			vorticity[i] = -(vx * normals[3 * i] + Vy * normals[3 * i + 1] + vz * normals[3 * i + 2]);
+		}
+		lu.solve(vorticity.data());
+
+		// Inviscid section lift and effective angle.
+		for (int s{ 0 }; s != n_strips; s++)
+		{
+			double gamma{ 0 };
+			for (int i : strips[s].panels) { gamma += vorticity[i]; }
+
+			cl_inv[s] = 2 * gamma / (Qinf * strips[s].chord);
+			alpha_eff[s] = nc::rad2deg(cl_inv[s] / two_pi - dalpha[s] + alpha_0l[s]);
+			cl_visc[s] = 0;
+			cd_visc[s] = 0;
+		}
+
+		// Vectorised polar lookup, blended between sections.
+		for (PolarGroup& g : groups)
+		{
+			for (int k{ 0 }; k != g.strips.size(); k++) { g.alpha[k] = alpha_eff[g.strips[k]]; }
+
+			g.polar->lookup(g.alpha.data(), g.cl.data(), g.cd.data(), (int)g.strips.size());
+
+			for (int k{ 0 }; k != g.strips.size(); k++) {
+				cl_visc[g.strips[k]] += g.weights[k] * g.cl[k];
+				cd_visc[g.strips[k]] += g.weights[k] * g.cd[k];
+			}
+		}
+
+		double residual{ 0 };
+		for (int s{ 0 }; s != n_strips; s++) {
+			if (!corrected[s]) { continue; }
+			residual = std::max(residual, std::abs(cl_visc[s] - cl_inv[s]));
+		}
+		if (residual < tolerance) {
+			viscousConverged = true;
+			break;
+		}
+
+		for (int s{ 0 }; s != n_strips; s++) {
+			if (!corrected[s]) { continue; }
+			dalpha[s] += relaxation * (cl_visc[s] - cl_inv[s]) / two_pi;
+		}
+	}
+	viscousIterations = std::min(viscousIterations, maxIterations);
+
+	calcLoads();
+
+	double Dv{ 0 };
+	for (int s{ 0 }; s != n_strips; s++)
+	{
+		Strip& strip{ strips[s] };
+		strip.dalpha = dalpha[s];
+		strip.alpha_eff = alpha_eff[s];
+		strip.cl = corrected[s] ? cl_visc[s] : cl_inv[s];
+		strip.cd = cd_visc[s];
+		strip.stalled = corrected[s] && alpha_eff[s] > alpha_stall[s];
+
+		Dv += 0.5 * rho * std::pow(Qinf, 2) * strip.cd * strip.chord * strip.dy;
+	}
+	CDv = Dv / (0.5 * rho * plane->S_ref * std::pow(Qinf, 2));
+}
+
+nc::NdArray<double> Vlm::freestreamOnset() const
+{
+	const int N{ plane->mesh->nPanels };
+	nc::NdArray<double> onset = nc::zeros<double>(N, 3);
+	for (int i{ 0 }; i != N; i++) {
+		onset(i, 0) = Qinf_vec[0];
+		onset(i, 1) = Qinf_vec[1];
+		onset(i, 2) = Qinf_vec[2];
+	}
+
+	return onset;
+}
+
+nc::NdArray<double> Vlm::collocationPoints() const
+{
+	nc::NdArray<double> points = nc::zeros<double>(plane->mesh->nPanels, 3);
+
+	int i{ 0 };
+	for (Panel& p : *plane->mesh)
+	{
+		points(i, 0) = p.cp[0];
+		points(i, 1) = p.cp[1];
+		points(i, 2) = p.cp[2];
+		i++;
+	}
+
+	return points;
+}
+
+/// <summary>
+/// Solves for an arbitrary onset velocity at each collocation point (e.g.
+/// freestream plus propwash) reusing the factorised influence matrix of the
+/// last runHorseshoe/runRing. Only the normal-wash RHS changes:
+///		RHS_i = -V_i . n_i
+/// Panel loads and CL/CDi are updated as for a steady solve.
+/// </summary>
+/// <param name="onset">Onset velocity at each collocation point (N x 3)</param>
+void Vlm::runOnset(const nc::NdArray<double>& onset)
+{
+	if (lu.empty()) {
+		throw std::logic_error("Vlm::runOnset requires a factorised runHorseshoe/runRing first.");
+	}
+
+	const int N{ plane->mesh->nPanels };
+	vorticity = nc::zeros<double>(N, 1);
+
+	int i{ 0 };
+	for (Panel& p : *plane->mesh)
+	{
+		vorticity[i] = -(
+			onset(i, 0) * p.normal[0] + onset(i, 1) * p.normal[1] + onset(i, 2) * p.normal[2]
+		);
+		i++;
+	}
+
+	lu.solve(vorticity.data());
+	calcLoads();
+}
+
+Vlm::LoadHistory Vlm::runOnset(const std::vector<nc::NdArray<double>>& onsets)
+{
+	return runOnset(
+		(int)onsets.size(),
+		[&](int step, nc::NdArray<double>& onset) { onset = onsets[step]; }
+	);
+}
+
+/// <summary>
+/// Time series of onset fields (gusts, heave/pitch motion, external induced
+/// velocities) solved against one factorisation. Steps are solved in blocks
+/// of blockSize right hand sides so each pass over the LU factors and the
+/// downwash matrix serves the whole block. Loads are quasi-steady: the wake
+/// stays the steady wake of the last runHorseshoe/runRing.
+/// </summary>
+/// <param name="nSteps">Number of time steps</param>
+/// <param name="onset">Fills the onset field (N x 3) of a step</param>
+/// <param name="blockSize">Right hand sides per blocked solve</param>
+/// <returns>CL and CDi at each step</returns>
+Vlm::LoadHistory Vlm::runOnset(int nSteps, const OnsetFunction& onset, int blockSize)
+{
+	if (lu.empty()) {
+		throw std::logic_error("Vlm::runOnset requires a factorised runHorseshoe/runRing first.");
+	}
+
+	const int N{ plane->mesh->nPanels };
+	blockSize = std::max(1, std::min(blockSize, nSteps));
+
+	// Panel geometry used every step.
+	std::vector<double> normals(3 * (size_t)N);
+	std::vector<double> dy(N);
+	int k{ 0 };
+	for (Panel& p : *plane->mesh)
+	{
+		normals[3 * k] = p.normal[0];
+		normals[3 * k + 1] = p.normal[1];
+		normals[3 * k + 2] = p.normal[2];
+		dy[k] = p.dy;
+		k++;
+	}
+
+	const double q_S{ 0.5 * rho * plane->S_ref * std::pow(Qinf, 2) };
+
+	LoadHistory history;
+	history.CL.resize(nSteps);
+	history.CDi.resize(nSteps);
+
+	nc::NdArray<double> field = nc::zeros<double>(N, 3);
+	std::vector<double> gamma((size_t)N * blockSize);	// N x nb, row-major
+	std::vector<double> w_ind((size_t)N * blockSize);
+
+	for (int t0{ 0 }; t0 < nSteps; t0 += blockSize)
+	{
+		const int nb{ std::min(blockSize, nSteps - t0) };
+
+		// Normal-wash RHS for each step of the block.
+		for (int t{ 0 }; t != nb; t++)
+		{
+			onset(t0 + t, field);
+			for (int i{ 0 }; i != N; i++) {
+				gamma[(size_t)i * nb + t] = -(
+					field(i, 0) * normals[3 * i]
+					+ field(i, 1) * normals[3 * i + 1]
+					+ field(i, 2) * normals[3 * i + 2]
+				);
+			}
+		}
+
+		lu.solve(gamma.data(), nb);
+
+		// Wake downwash of the whole block: w = b . gamma
+		std::fill(w_ind.begin(), w_ind.begin() + (size_t)N * nb, 0);
+		for (int i{ 0 }; i != N; i++) {
+			double* w_i{ &w_ind[(size_t)i * nb] };
+			for (int j{ 0 }; j != N; j++) {
+				const double b_ij{ b(i, j) };
+				const double* gamma_j{ &gamma[(size_t)j * nb] };
+				for (int t{ 0 }; t != nb; t++) { w_i[t] += b_ij * gamma_j[t]; }
+			}
+		}
+
+		for (int t{ 0 }; t != nb; t++)
+		{
+			double L{ 0 };
+			double Di{ 0 };
+			for (int i{ 0 }; i != N; i++) {
+				double gamma_i{ gamma[(size_t)i * nb + t] };
+				if (!upstream.empty() && upstream[i] >= 0) {
+					gamma_i -= gamma[(size_t)upstream[i] * nb + t];
+				}
+				L += rho * Qinf * gamma_i * dy[i];
+				Di += -rho * w_ind[(size_t)i * nb + t] * gamma_i * dy[i];
+			}
+
+			history.CL[t0 + t] = L / q_S;
+			history.CDi[t0 + t] = Di / q_S;
+		}
+	}
+
+	return history;
+}
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include <pch.h>
+
+#include <adaptive.hpp>
+#include <mesh.hpp>
+#include <vlm.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+    /// <summary>
+    /// Node positions of a spacing over m panels, with exact end points.
+    /// </summary>
+    std::vector<double> spacingNodes(const utils::Spacing& spacing, int m)
+    {
+        std::vector<double> nodes(m + 1);
+        for (int k{ 0 }; k <= m; k++) { nodes[k] = spacing(k, m); }
+        nodes.front() = 0;
+        nodes.back() = 1;
+        return nodes;
+    }
+
+    /// <summary>
+    /// Splits the flagged intervals of a node list at their midpoints.
+    /// </summary>
+    utils::Spacing splitSpacing(const utils::Spacing& spacing, int m, const char* flags)
+    {
+        std::vector<double> coarse{ spacingNodes(spacing, m) };
+
+        utils::Spacing fine;
+        fine.type = utils::Spacing::Type::custom;
+        fine.points.push_back(coarse[0]);
+        for (int k{ 0 }; k != m; k++)
+        {
+            if (flags[k]) { fine.points.push_back(0.5 * (coarse[k] + coarse[k + 1])); }
+            fine.points.push_back(coarse[k + 1]);
+        }
+        return fine;
+    }
+}
+
+Adaptive::Adaptive(std::ifstream& spec)
+{
+    read_spec(spec);
+}
+
+/// <summary>
+/// Reads the refinement spec and the starting plane. See adaptive.hpp for
+/// layout.
+/// </summary>
+/// <param name="file"> {std::ifstream}: Input .json filestream.</param>
+void Adaptive::read_spec(std::ifstream& file)
+{
+    json j_spec = json::parse(file);
+    file.close();
+
+    std::string plane_file = j_spec["plane"];
+    std::ifstream f{ plane_file };
+    if (f.fail()) {
+        throw std::runtime_error("Plane file not found: " + plane_file);
+    }
+    nThreads = j_spec.value("threads", nThreads);
+    nominal = std::make_unique<Plane>(f, nThreads);
+
+    Qinf = j_spec.value("Qinf", Qinf);
+    alpha = j_spec.value("alpha", alpha);
+    beta = j_spec.value("beta", beta);
+    rho = j_spec.value("rho", rho);
+
+    tolerance = j_spec.value("tolerance", tolerance);
+    fraction = j_spec.value("fraction", fraction);
+    maxLevels = std::max(j_spec.value("max_levels", maxLevels), 1);
+    maxPanels = j_spec.value("max_panels", maxPanels);
+    compareUniform = j_spec.value("compare_uniform", compareUniform);
+
+    if (fraction <= 0 || fraction > 1) {
+        throw std::invalid_argument("Refinement fraction must be in (0, 1].");
+    }
+}
+
+/// <summary>
+/// Error indicators of the solved plane (see adaptive.hpp), then Dorfler
+/// marking: strips and rows are flagged in decreasing order of indicator
+/// until the flagged ones hold fraction of the total.
+/// </summary>
+std::vector<Adaptive::Flags> Adaptive::mark(Plane& plane) const
+{
+    struct Indicator {
+        double value;
+        int wing;
+        int index;
+        bool row;
+    };
+    std::vector<Indicator> indicators;
+    std::vector<Flags> flags(plane.n_wings);
+
+    for (int w{ 0 }; w != plane.n_wings; w++)
+    {
+        const Wing& wing{ *plane.wings[w] };
+        const int n{ wing.n };
+        const int m{ wing.m_sum };
+        std::span<Panel> panels{ plane.mesh->panels(w) };
+
+        flags[w].strips.assign(m, 0);
+        flags[w].rows.assign(n, 0);
+
+        // Strip circulation.
+        std::vector<double> Gamma(m, 0);
+        for (int i{ 0 }; i != n; i++) {
+            for (int j{ 0 }; j != m; j++) { Gamma[j] += panels[j + m * i].vorticity; }
+        }
+
+        // Beyond each end: the mirror image on y = 0, else a free tip.
+        auto on_mirror = [](const Section& section) {
+            return std::abs(section.leading_edge[1]) < 1e-6 * section.chord;
+        };
+        double Gamma_first{ on_mirror(wing.sections.front()) ? Gamma.front() : 0 };
+        double Gamma_last{ on_mirror(wing.sections.back()) ? Gamma.back() : 0 };
+
+        for (int j{ 0 }; j != m; j++)
+        {
+            double left{ j == 0 ? Gamma_first : Gamma[j - 1] };
+            double right{ j == m - 1 ? Gamma_last : Gamma[j + 1] };
+            double jump{ std::max(std::abs(Gamma[j] - left), std::abs(right - Gamma[j])) };
+            indicators.push_back({ jump * panels[j].dy, w, j, false });
+        }
+
+        // Chordwise load jumps, summed along the row.
+        auto q = [&](int i, int j) {
+            const Panel& p{ panels[j + m * i] };
+            return p.vorticity * p.dy / p.area;
+        };
+        for (int i{ 0 }; i != n; i++)
+        {
+            double value{ 0 };
+            for (int j{ 0 }; j != m; j++)
+            {
+                const Panel& p{ panels[j + m * i] };
+                double q_ij{ q(i, j) };
+                double jump{ 0 };
+                if (i > 0) { jump = std::max(jump, std::abs(q_ij - q(i - 1, j))); }
+                if (i < n - 1) { jump = std::max(jump, std::abs(q(i + 1, j) - q_ij)); }
+                value += jump * p.area;
+            }
+            indicators.push_back({ value, w, i, true });
+        }
+    }
+
+    double total{ 0 };
+    for (const Indicator& e : indicators) { total += e.value; }
+
+    std::sort(indicators.begin(), indicators.end(),
+        [](const Indicator& a, const Indicator& b) { return a.value > b.value; });
+
+    double flagged{ 0 };
+    for (const Indicator& e : indicators)
+    {
+        if (flagged >= fraction * total || e.value == 0) { break; }
+        (e.row ? flags[e.wing].rows : flags[e.wing].strips)[e.index] = 1;
+        flagged += e.value;
+    }
+
+    return flags;
+}
+
+/// <summary>
+/// Copies the plane's wings with the flagged strips and rows split in two.
+/// Spacings become custom node lists. If guess is given, it receives the
+/// plane's solved vortex strengths interpolated onto the refined mesh:
+/// a split strip keeps its parent's strength, a split row shares it.
+/// </summary>
+std::vector<std::unique_ptr<Wing>> Adaptive::refine(
+    Plane& plane, const std::vector<Flags>& flags, nc::NdArray<double>* guess
+)
+{
+    std::vector<std::unique_ptr<Wing>> wings{ plane.copyWings() };
+    std::vector<double> values;
+
+    for (int w{ 0 }; w != (int)wings.size(); w++)
+    {
+        Wing& wing{ *wings[w] };
+        const Flags& f{ flags[w] };
+        const int n{ wing.n };
+        const int m{ wing.m_sum };
+
+        // Fine column -> coarse column, fine row -> coarse row and share.
+        std::vector<int> columns;
+        std::vector<int> rows;
+        std::vector<double> shares;
+
+        int j{ 0 };
+        for (int s{ 1 }; s < (int)wing.sections.size(); s++)
+        {
+            Section& section{ wing.sections[s] };
+            section.spanwise = splitSpacing(section.spanwise, section.m, f.strips.data() + j);
+
+            for (int k{ 0 }; k != section.m; k++, j++)
+            {
+                columns.push_back(j);
+                if (f.strips[j]) { columns.push_back(j); }
+            }
+            section.m = (int)section.spanwise.points.size() - 1;
+        }
+        wing.m_sum = (int)columns.size();
+
+        for (Section& section : wing.sections) {
+            section.chordwise = splitSpacing(section.chordwise, n, f.rows.data());
+        }
+        for (int i{ 0 }; i != n; i++)
+        {
+            rows.push_back(i);
+            shares.push_back(f.rows[i] ? 0.5 : 1);
+            if (f.rows[i]) {
+                rows.push_back(i);
+                shares.push_back(0.5);
+            }
+        }
+        wing.n = (int)rows.size();
+
+        if (guess != nullptr)
+        {
+            std::span<Panel> panels{ plane.mesh->panels(w) };
+            for (int i{ 0 }; i != wing.n; i++) {
+                for (int jf{ 0 }; jf != wing.m_sum; jf++) {
+                    values.push_back(panels[columns[jf] + m * rows[i]].vorticity * shares[i]);
+                }
+            }
+        }
+    }
+
+    if (guess != nullptr)
+    {
+        *guess = nc::zeros<double>((int)values.size(), 1);
+        std::copy(values.begin(), values.end(), guess->begin());
+    }
+
+    return wings;
+}
+
+/// <summary>
+/// Solves the nominal mesh, then refined meshes until CDi converges, a
+/// level would exceed maxPanels, or maxLevels is reached. adaptive: flagged
+/// strips/rows and warm-started GMRES; otherwise every strip and row is
+/// split and solved directly. One JSON line is written per level.
+/// </summary>
+Adaptive::Result Adaptive::refineLevels(bool adaptive, std::ostream& out) const
+{
+    auto start{ std::chrono::high_resolution_clock::now() };
+    auto seconds = [](std::chrono::high_resolution_clock::time_point t0) {
+        std::chrono::duration<double> dt{ std::chrono::high_resolution_clock::now() - t0 };
+        return dt.count();
+    };
+
+    Result result;
+    std::unique_ptr<Plane> plane{ std::make_unique<Plane>(nominal->copyWings(), nThreads) };
+    nc::NdArray<double> guess;
+
+    for (int k{ 0 }; k != maxLevels; k++)
+    {
+        Level level;
+        level.panels = plane->mesh->nPanels;
+
+        auto solve_start{ std::chrono::high_resolution_clock::now() };
+        Vlm vlm{ plane.get(), false };
+        vlm.setThreads(nThreads);
+        if (guess.size() == 0) { vlm.runHorseshoe(Qinf, alpha, beta, rho); }
+        else { vlm.runHorseshoe(Qinf, alpha, beta, rho, guess); }
+        level.solve_s = seconds(solve_start);
+
+        level.CL = vlm.CL;
+        level.CDi = vlm.CDi;
+        level.iterations = vlm.refineIterations;
+        if (k > 0) {
+            level.change = std::abs(vlm.CDi - result.levels.back().CDi)
+                / std::max(std::abs(vlm.CDi), 1e-12);
+        }
+        // A small refinement step can change CDi little before it has
+        // converged, so two successive changes must be within tolerance.
+        result.converged = k > 1 && level.change < tolerance
+            && result.levels.back().change < tolerance;
+
+        std::vector<Flags> flags;
+        int next_panels{ 0 };
+        if (!result.converged && k + 1 != maxLevels)
+        {
+            if (adaptive) {
+                flags = mark(*plane);
+            }
+            else {
+                for (const std::unique_ptr<Wing>& wing : plane->wings) {
+                    flags.push_back({ std::vector<char>(wing->m_sum, 1), std::vector<char>(wing->n, 1) });
+                }
+            }
+
+            for (int w{ 0 }; w != plane->n_wings; w++)
+            {
+                int strips{ (int)std::count(flags[w].strips.begin(), flags[w].strips.end(), 1) };
+                int rows{ (int)std::count(flags[w].rows.begin(), flags[w].rows.end(), 1) };
+                level.strips += strips;
+                level.rows += rows;
+                next_panels += (plane->wings[w]->m_sum + strips) * (plane->wings[w]->n + rows);
+            }
+        }
+        level.elapsed_s = seconds(start);
+        result.levels.push_back(level);
+
+        json record;
+        record["mode"] = adaptive ? "adaptive" : "uniform";
+        record["level"] = k;
+        record["panels"] = level.panels;
+        record["CL"] = level.CL;
+        record["CDi"] = level.CDi;
+        record["change"] = level.change;
+        record["solver"] = level.iterations >= 0 ? "gmres" : "direct";
+        record["iterations"] = level.iterations;
+        record["strips_refined"] = level.strips;
+        record["rows_refined"] = level.rows;
+        record["solve_s"] = level.solve_s;
+        record["elapsed_s"] = level.elapsed_s;
+        out << record.dump() << std::endl;
+
+        if (result.converged || flags.empty() || next_panels > maxPanels) { break; }
+        if (level.strips + level.rows == 0) { break; }
+
+        std::vector<std::unique_ptr<Wing>> wings{ refine(*plane, flags, adaptive ? &guess : nullptr) };
+        plane = std::make_unique<Plane>(std::move(wings), nThreads);
+    }
+
+    return result;
+}
+
+/// <summary>
+/// Adaptive levels, then (optionally) uniform levels from the same mesh,
+/// and a summary line comparing the final panel counts and total times.
+/// </summary>
+void Adaptive::run(std::ostream& out)
+{
+    auto summary = [](const Result& result) {
+        const Level& last{ result.levels.back() };
+        json j;
+        j["panels"] = last.panels;
+        j["CL"] = last.CL;
+        j["CDi"] = last.CDi;
+        j["levels"] = (int)result.levels.size();
+        j["converged"] = result.converged;
+        j["elapsed_s"] = last.elapsed_s;
+        return j;
+    };
+
+    Result adaptive{ refineLevels(true, out) };
+
+    json record;
+    record["summary"] = true;
+    record["tolerance"] = tolerance;
+    record["adaptive"] = summary(adaptive);
+
+    if (compareUniform)
+    {
+        Result uniform{ refineLevels(false, out) };
+        record["uniform"] = summary(uniform);
+
+        const Level& a{ adaptive.levels.back() };
+        const Level& u{ uniform.levels.back() };
+        record["panel_ratio"] = (double)a.panels / u.panels;
+        record["speedup"] = a.elapsed_s > 0 ? u.elapsed_s / a.elapsed_s : 0;
+    }
+
+    out << record.dump() << std::endl;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <pch.h>
+
+#include <plane.hpp>
+
+/// <summary>
+/// Adaptive mesh refinement of one plane at one flight condition. Each level
+/// solves the horseshoe lattice, estimates the local discretisation error of
+/// every spanwise strip and chordwise row from circulation gradients and
+/// load jumps, and splits the strips/rows carrying the largest share of the
+/// total indicator (Dorfler marking). The refined mesh is solved by GMRES
+/// from the coarse solution interpolated onto it. Levels stop when CDi
+/// changes by less than tolerance (relative) over two successive levels.
+///
+/// Indicators, per wing, from the bound vortex strengths gamma(i, j), as
+/// the load error of a piecewise constant distribution (jump x extent):
+///     strip j:    max |Gamma_j - Gamma_j+-1| dy_j, Gamma_j = sum_i gamma(i, j)
+///                 (0 beyond a free tip, Gamma_j beyond a root on y = 0)
+///     row i:      sum_j max |q(i, j) - q(i+-1, j)| dx dy, q = gamma / dx
+/// Refinement inserts a node midway in the section's spanwise/chordwise
+/// spacing, so the mesh stays structured and every fine panel lies inside
+/// one coarse panel.
+///
+/// Spec layout:
+/// {
+///     "plane": "wing.json", "Qinf": 1, "alpha": 5, "beta": 0, "rho": 1.225,
+///     "tolerance": 1e-3, "fraction": 0.5, "max_levels": 10,
+///     "max_panels": 20000, "threads": 0, "compare_uniform": true
+/// }
+/// compare_uniform also refines every strip and row (direct solves) from
+/// the same starting mesh to the same tolerance, for reference.
+/// </summary>
+class Adaptive {
+public:
+    struct Level {
+        int panels{ 0 };
+        double CL{ 0 };
+        double CDi{ 0 };
+        double change{ 0 };         // relative CDi change from the previous level
+        int iterations{ -1 };       // GMRES iterations, -1 for a direct solve
+        int strips{ 0 };            // strips and rows split for the next level
+        int rows{ 0 };
+        double solve_s{ 0 };
+        double elapsed_s{ 0 };      // since the first level
+    };
+
+    struct Result {
+        std::vector<Level> levels;
+        bool converged{ false };
+    };
+
+private:
+    // Refinement flags of one wing.
+    struct Flags {
+        std::vector<char> strips;
+        std::vector<char> rows;
+    };
+
+    std::unique_ptr<Plane> nominal;
+
+    double Qinf{ 1 };
+    double alpha{ 0 };
+    double beta{ 0 };
+    double rho{ 1.225 };
+
+    double tolerance{ 1e-3 };
+    double fraction{ 0.5 };
+    int maxLevels{ 10 };
+    int maxPanels{ 20000 };
+    int nThreads{ 0 };
+    bool compareUniform{ true };
+
+    void read_spec(std::ifstream& file);
+    std::vector<Flags> mark(Plane& plane) const;
+    static std::vector<std::unique_ptr<Wing>> refine(
+        Plane& plane, const std::vector<Flags>& flags, nc::NdArray<double>* guess
+    );
+    Result refineLevels(bool adaptive, std::ostream& out) const;
+
+public:
+    Adaptive(std::ifstream& spec);
+
+    void run(std::ostream& out);
+
+};
@@ -1,109 +1,135 @@
 #include <pch.h>
 
 #include <aerofoil.hpp>
-#include <utils/algorithms.hpp>
+#include <utils/text.hpp>
 
-Aerofoil::Aerofoil(std::string filepath)
+Aerofoil::Aerofoil(std::string filepath, bool deferred)
 	: filepath{ filepath }
 {
-	read_dat();
-	calc_camber();
+	if (!deferred) { load(); }
 
 }
 
-void Aerofoil::read_dat()
+Aerofoil::Aerofoil(
+	std::string filepath, std::shared_ptr<const void> storage,
+	const double* unitCamber, int rows
+)
+	: filepath{ filepath }
+	, packStorage{ std::move(storage) }
+	, packCamber{ unitCamber }
+	, packRows{ rows }
 {
-	// Open file
-	std::ifstream file;
-	file.open(filepath);
-
-	// Replace with flat plate if file not found
-	if (file.fail())
-	{
-		std::cout << "Aerofoil not found: " << filepath << '\n';
-		std::cout << "Using flat plate instead." << "\n\n";
-
-		coords = flat_plate();
-	}
-	else
-	{
-		// Read .dat file
-		std::vector<std::array<double, 3>> coords_;
-		std::string line;
-		int line_count{ -1 };
 
-		while (std::getline(file, line))
-		{
-			line_count++;
-
-			if (line == "") { continue; } // skip black lines - not sure if needed.
-
-			std::vector<std::string> words{ split_string_delim(line,' ') };
+}
 
-			// Remove empty words (filters extra white spaces etc)
-			for (int i{ 0 }; i != words.size(); i++) {
-				if (words[i] == "") {
-					words.erase(words.begin() + i);
-					i--;
-				}
-			}
+Aerofoil::Aerofoil(const AnalyticCamber& camber)
+	: filepath{ camber.get_name() }
+	, analytic{ std::make_unique<AnalyticCamber>(camber) }
+{
 
-			// Skip if there are not exactly 2 words in the filtered line
-			if (words.size() != 2) { continue; }
+}
 
-			// Try to convert 2 strings into doubles.
-			double x, z;
-			try {
-				x = std::stod(words[0]);
-				z = std::stod(words[1]);
-			}
-			catch (std::invalid_argument err) {
-				// continue if word is not double.
-				continue;
+/// <summary>
+/// Reads the .dat file (or preprocessed camber line) once. Analytic camber
+/// lines are only tabulated at cosine spaced stations for
+/// get_unit_camber_line.
+/// </summary>
+void Aerofoil::load()
+{
+	std::call_once(loaded, [this]() {
+		if (analytic)
+		{
+			const int n{ 100 };
+			const std::vector<double> line{ evaluate(n, { utils::Spacing::Type::cosine }) };
+			unitX.resize(n + 1);
+			unitZ.resize(n + 1);
+			for (int i{ 0 }; i != n + 1; i++) {
+				unitX[i] = line[2 * i];
+				unitZ[i] = line[2 * i + 1];
 			}
-
-			coords_.push_back(std::array<double, 3> {x, 0, z});
 		}
-
-		// Assign coords to temp coords array.
-		if (coords_.size() != 0)
+		else if (packCamber != nullptr)
 		{
-			coords = nc::zeros<double>(coords_.size(), 3);
-
-			for (int i{ 0 }; i != coords_.size(); i++) {
-				coords(i, 0) = coords_[i][0];
-				coords(i, 1) = coords_[i][1];
-				coords(i, 2) = coords_[i][2];
-
+			unitX.resize(packRows);
+			unitZ.resize(packRows);
+			for (int i{ 0 }; i != packRows; i++) {
+				unitX[i] = packCamber[2 * i];
+				unitZ[i] = packCamber[2 * i + 1];
 			}
+			packStorage.reset();
+			packCamber = nullptr;
 		}
-		else // if aerofoil file is empty (likely because deliminated incorrectly).
+		else
 		{
-			std::cout << "Error: Aerofoil file '" << filepath << "' is corrupt." << '\n';
-			std::cout << "Coordinates must be defined with a space between:" << "\n\n";
-
-			coords = flat_plate();
+			read_dat();
+			calc_camber();
+			calc_unit_camber();
 		}
-	}
-	file.close();
+		calc_arc_length();
+	});
+}
+
+std::vector<double> Aerofoil::get_unit_camber_line()
+{
+	load();
 
+	std::vector<double> line(2 * unitX.size());
+	for (std::size_t i{ 0 }; i != unitX.size(); i++) {
+		line[2 * i] = unitX[i];
+		line[2 * i + 1] = unitZ[i];
+	}
+	return line;
 }
 
-/// <param name="s">- String to split</param>
-/// <param name="del">- Deliminator to split by</param>
-/// <returns>Split string</returns>
-std::vector<std::string> Aerofoil::split_string_delim(std::string s, char del)
+/// <summary>
+/// Reads the .dat file in one read and parses it in place. Every line of
+/// exactly 2 numbers is a coordinate (x, z); anything else (names, headers,
+/// blank lines) is skipped.
+/// </summary>
+void Aerofoil::read_dat()
 {
-	std::stringstream ss{ s };
-	std::string word;
-	std::vector<std::string> words;
-	while (!ss.eof())
+	std::string text;
+
+	// Replace with flat plate if file not found
+	if (!utils::readText(filepath, text))
+	{
+		// One write - aerofoils may be loaded concurrently.
+		std::cout << "Aerofoil not found: " + filepath + "\nUsing flat plate instead.\n\n";
+
+		coords = flat_plate();
+		return;
+	}
+
+	std::vector<double> coords_;
+	coords_.reserve(2 * (std::count(text.begin(), text.end(), '\n') + 1));
+
+	const char* first{ text.data() };
+	utils::forEachLine(first, first + text.size(), [&](const char* line, const char* line_end) {
+		double xz[2];
+		if (utils::parseNumbers(line, line_end, xz, 2) == 2) {
+			coords_.push_back(xz[0]);
+			coords_.push_back(xz[1]);
+		}
+	});
+
+	// Assign coords to temp coords array.
+	if (coords_.size() != 0)
 	{
-		std::getline(ss, word, del);
-		words.push_back(word);
+		const int rows{ (int)coords_.size() / 2 };
+		coords = nc::zeros<double>(rows, 3);
+
+		for (int i{ 0 }; i != rows; i++) {
+			coords(i, 0) = coords_[2 * i];
+			coords(i, 2) = coords_[2 * i + 1];
+		}
 	}
+	else // if aerofoil file is empty (likely because deliminated incorrectly).
+	{
+		std::cout << "Error: Aerofoil file '" << filepath << "' is corrupt." << '\n';
+		std::cout << "Coordinates must be defined with a space between:" << "\n\n";
 
-	return words;
+		coords = flat_plate();
+	}
 }
 
 nc::NdArray<double> Aerofoil::flat_plate()
@@ -146,10 +172,9 @@ std::array<nc::NdArray<double>, 2> Aerofoil::split_surface()
 	}
 
 	if (split_index == -1) {
-		std::cout << "Error: Aerofoil '" << filepath <<
-			"' must contain coordinate at (0, 0).";
-
-		exit(0);
+		throw std::runtime_error(
+			"Error: Aerofoil '" + filepath + "' must contain coordinate at (0, 0)."
+		);
 	}
 	else
 	{
@@ -175,10 +200,10 @@ void Aerofoil::calc_camber()
 	nc::NdArray<double> lower{ ul[1] };
 
 	if (upper.shape().rows != lower.shape().rows) {
-		std::cout << "Error: Uneven point distribution on upper and lower"
-			" surfaces of aerofoil '" << filepath << "\n\n";
-
-		exit(0);
+		throw std::runtime_error(
+			"Error: Uneven point distribution on upper and lower"
+			" surfaces of aerofoil '" + filepath + "'."
+		);
 	}
 
 	int n_per_side = upper.shape().rows;
@@ -210,85 +235,159 @@ void Aerofoil::calc_camber()
 	}
 }
 
-// Scales camber by new chord length.
-nc::NdArray<double> Aerofoil::scale_chord(double chord)
+/// <summary>
+/// Camber line at unit chord. The camber line starts at the leading edge
+/// (0, 0, 0) - the surface split point - so it scales linearly with chord.
+/// </summary>
+void Aerofoil::calc_unit_camber()
 {
-	nc::NdArray<double> camber_scaled = camber;
+	const int rows{ (int)camber.shape().rows };
+	const double x0{ camber(0, 0) };
+	const double z0{ camber(0, 2) };
+	const double scaling_factor{ 1 / (camber(rows - 1, 0) - x0) };
 
-	double scaling_factor{
-		chord / (camber(camber.shape().rows - 1, 0) - camber(0, 0))
-	};
+	unitX.resize(rows);
+	unitZ.resize(rows);
 
-	nc::NdArray<double> A = camber(0, camber.cSlice());
-	for (int i{ 1 }; i != camber.shape().rows; i++)
+	unitX[0] = 0;
+	unitZ[0] = 0;
+	for (int i{ 1 }; i != rows; i++)
 	{
-		nc::NdArray<double> B = camber(i, camber.cSlice());
-		auto AB = B - A;
-
-		camber_scaled(i, 0) = AB[0] * scaling_factor;
-		camber_scaled(i, 2) = AB[2] * scaling_factor;
+		unitX[i] = (camber(i, 0) - x0) * scaling_factor;
+		unitZ[i] = (camber(i, 2) - z0) * scaling_factor;
 	}
-
-	return camber_scaled;
 }
 
 /// <summary>
-/// Scales and redistributes points on camberline.
+/// Cumulative arc length along the unit chord camber line.
 /// </summary>
-/// <param name="n">: # chordwise points</param>
-/// <param name="chord">New chordlength</param>
-/// <returns>Camberline coordiantes</returns>
-nc::NdArray<double> Aerofoil::get_camber_points(int n, double chord)
+void Aerofoil::calc_arc_length()
 {
-	nc::NdArray<double> camber_scaled{ scale_chord(chord) };
+	const int rows{ (int)unitX.size() };
+	unitArc.resize(rows);
 
-	// Calculate incrimental line length along camberline.
-	std::vector<double> L_is{ 0 };
-	double L{ 0 };
-	for (int i{ 1 }; i != camber.shape().rows; i++)
+	unitArc[0] = 0;
+	for (int i{ 1 }; i != rows; i++)
 	{
-		L_is.push_back(
-			nc::norm(
-				camber_scaled(i, camber_scaled.cSlice())
-				- camber_scaled(i - 1, camber_scaled.cSlice())
-			)[0] + L
-		);
-		L += L_is[i] - L ;
-	};
+		const double dx{ unitX[i] - unitX[i - 1] };
+		const double dz{ unitZ[i] - unitZ[i - 1] };
+		unitArc[i] = unitArc[i - 1] + std::sqrt(dx * dx + dz * dz);
+	}
+}
 
-	nc::NdArray<double> camber_interp = nc::zeros<double>(n + 1, 3);
+/// <summary>
+/// Redistributes points on the unit chord camberline. Stations are sorted
+/// along the arc, so the segment holding each one is found by a single
+/// forward pass over the arc length table.
+/// </summary>
+/// <param name="n">: # chordwise points</param>
+/// <param name="spacing">Distribution of points along the camberline arc
+/// length</param>
+/// <returns>(n + 1) x 2 camberline coordinates (x, z)</returns>
+std::vector<double> Aerofoil::resample(int n, const utils::Spacing& spacing) const
+{
+	const int last{ (int)unitArc.size() - 1 };
+	const double L{ unitArc[last] };
 
-	double spacing{ L / (n)};
-	double dL{ 0 };
+	std::vector<double> camber_interp(2 * (size_t)(n + 1));
+
+	int P1_i{ 0 };
+	double dL_prev{ 0 };
 	for (int i{ 0 }; i != n + 1; i++)
 	{
-		// Search for index where cumulative length would lie.
-		int P1_i{ utils::search(L_is,dL,"left") };
-		int P0_i{ P1_i - 1 };
-		if (P0_i < 0) { P0_i = 0; }
+		// Arc length of point i.
+		const double dL{ L * (spacing.uniform() ? (double)i / n : spacing(i, n)) };
+
+		// First table entry at or beyond dL, clamped to the trailing edge.
+		if (dL < dL_prev) { P1_i = 0; }
+		while (P1_i < last && unitArc[P1_i] < dL) { P1_i++; }
+		dL_prev = dL;
 
-		nc::NdArray<double> P0 { camber_scaled(P0_i, camber_scaled.cSlice()) };
-		nc::NdArray<double> P1 { camber_scaled(P1_i, camber_scaled.cSlice()) };
-		double L0{ L_is[P0_i] };
-		double L1{ L_is[P1_i] };
+		const int P0_i{ std::max(P1_i - 1, 0) };
+		const double L0{ unitArc[P0_i] };
+		const double L1{ unitArc[P1_i] };
 
 		// Linear interpolation
-		double ratio;
-		if (dL != L_is[P0_i]) {
-			ratio = (dL - L0) / (L1 - L0);
-		}
-		else {
-			ratio = 0;
-		}
+		const double ratio{ dL != L0 ? (dL - L0) / (L1 - L0) : 0 };
 
-		nc::NdArray<double> P01{ P1 - P0 };
-		nc::NdArray<double> P_interp{ P0 + P01 * ratio };
+		camber_interp[2 * i] = unitX[P0_i] + (unitX[P1_i] - unitX[P0_i]) * ratio;
+		camber_interp[2 * i + 1] = unitZ[P0_i] + (unitZ[P1_i] - unitZ[P0_i]) * ratio;
+	}
 
-		camber_interp(i, 0) = P_interp[0];
-		camber_interp(i, 2) = P_interp[2];
+	return camber_interp;
+}
 
-		dL += spacing;
+/// <summary>
+/// Analytic camber line at n + 1 chordwise stations. The stations are
+/// distributed along the chord rather than the arc length, which differs
+/// little for thin camber lines.
+/// </summary>
+/// <param name="n">: # chordwise points</param>
+/// <param name="spacing">Distribution of points along the chord</param>
+/// <returns>(n + 1) x 2 camberline coordinates (x, z)</returns>
+std::vector<double> Aerofoil::evaluate(int n, const utils::Spacing& spacing) const
+{
+	std::vector<double> x(n + 1);
+	for (int i{ 0 }; i != n + 1; i++) {
+		x[i] = spacing.uniform() ? (double)i / n : spacing(i, n);
+	}
+
+	std::vector<double> z(n + 1);
+	analytic->evaluate(x.data(), z.data(), n + 1);
+
+	std::vector<double> camber_points(2 * (size_t)(n + 1));
+	for (int i{ 0 }; i != n + 1; i++) {
+		camber_points[2 * i] = x[i];
+		camber_points[2 * i + 1] = z[i];
+	}
+
+	return camber_points;
+}
+
+const std::vector<double>& Aerofoil::get_unit_camber(int n, const utils::Spacing& spacing)
+{
+	load();
+
+	// Parameters a distribution does not use are left out of the key.
+	CamberKey key{
+		n,
+		spacing.type,
+		spacing.type == utils::Spacing::Type::tanh ? spacing.clustering : 0,
+		spacing.type == utils::Spacing::Type::custom ? spacing.points : std::vector<double>{}
+	};
+
+	{
+		std::shared_lock<std::shared_mutex> lock{ resampledMutex };
+		auto it{ resampled.find(key) };
+		if (it != resampled.end()) { return it->second; }
+	}
+
+	// Resample outside the lock. If another thread got there first, its
+	// (identical) result is kept.
+	std::vector<double> points{ analytic ? evaluate(n, spacing) : resample(n, spacing) };
+
+	std::unique_lock<std::shared_mutex> lock{ resampledMutex };
+	return resampled.try_emplace(std::move(key), std::move(points)).first->second;
+}
+
+/// <summary>
+/// Scales and redistributes points on camberline.
+/// </summary>
+/// <param name="n">: # chordwise points</param>
+/// <param name="chord">New chordlength</param>
+/// <param name="spacing">Distribution of points along the camberline arc
+/// length (default uniform)</param>
+/// <returns>Camberline coordiantes</returns>
+nc::NdArray<double> Aerofoil::get_camber_points(int n, double chord, const utils::Spacing& spacing)
+{
+	const std::vector<double>& unit{ get_unit_camber(n, spacing) };
+
+	nc::NdArray<double> camber_interp = nc::zeros<double>(n + 1, 3);
+	for (int i{ 0 }; i != n + 1; i++)
+	{
+		camber_interp(i, 0) = chord * unit[2 * i];
+		camber_interp(i, 2) = chord * unit[2 * i + 1];
 	}
 
 	return camber_interp;
-}
\ No newline at end of file
+}
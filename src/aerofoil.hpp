@@ -2,6 +2,13 @@
 
 #include <pch.h>
 
+#include <map>
+#include <tuple>
+#include <shared_mutex>
+
+#include <utils/spacing.hpp>
+#include <analyticcamber.hpp>
+
 class Aerofoil
 {
 private:
@@ -9,19 +16,79 @@ private:
 	nc::NdArray<double> coords;
 	nc::NdArray<double> camber;
 
+	// Camber line at unit chord and cumulative arc length along it.
+	std::vector<double> unitX;
+	std::vector<double> unitZ;
+	std::vector<double> unitArc;
+
+	// Preprocessed unit chord camber line (x, z interleaved) to load from
+	// instead of the file, kept alive by packStorage.
+	std::shared_ptr<const void> packStorage;
+	const double* packCamber{ nullptr };
+	int packRows{ 0 };
+
+	// Analytic camber line, evaluated at the requested stations instead.
+	std::unique_ptr<AnalyticCamber> analytic;
+
+	std::once_flag loaded;
+
+	// Resampled unit chord camber lines by station count and distribution.
+	struct CamberKey {
+		int n;
+		utils::Spacing::Type type;
+		double clustering;
+		std::vector<double> points;
+
+		bool operator<(const CamberKey& other) const {
+			return std::tie(n, type, clustering, points)
+				< std::tie(other.n, other.type, other.clustering, other.points);
+		}
+	};
+	std::map<CamberKey, std::vector<double>> resampled;
+	std::shared_mutex resampledMutex;
+
 	// Utility functions
-	std::vector<std::string> split_string_delim(std::string s, char del);
 	nc::NdArray<double> flat_plate();
 	std::array<nc::NdArray<double>, 2> split_surface();
-	nc::NdArray<double> scale_chord(double chord);
 
 	// Method functions
 	void read_dat();
 	void calc_camber();
+	void calc_unit_camber();
+	void calc_arc_length();
+	std::vector<double> resample(int n, const utils::Spacing& spacing) const;
+	std::vector<double> evaluate(int n, const utils::Spacing& spacing) const;
 
 public:
-	Aerofoil(std::string filepath);
+	// deferred: read the file on first use (e.g. planes whose meshes come
+	// from the mesh cache only need aerofoils if they are re-meshed).
+	Aerofoil(std::string filepath, bool deferred = false);
+
+	// Aerofoil from a preprocessed unit chord camber line (rows x 2, x and z
+	// interleaved, from the leading edge) held by storage, e.g. an aerofoil
+	// library pack. Loaded on first use.
+	Aerofoil(
+		std::string filepath, std::shared_ptr<const void> storage,
+		const double* unitCamber, int rows
+	);
+
+	// Aerofoil from an analytic camber line (NACA or CST), no file.
+	Aerofoil(const AnalyticCamber& camber);
+
+	// Reads the aerofoil now rather than on first use. Safe to call
+	// concurrently.
+	void load();
+
+	// Camber line at unit chord as loaded, rows x 2, x and z interleaved.
+	std::vector<double> get_unit_camber_line();
+
+	// Camber line at unit chord resampled to n + 1 stations along its arc
+	// length (analytic camber lines: evaluated at n + 1 chordwise
+	// stations), x and z interleaved. Memoised per (n, spacing) - sections
+	// that share an aerofoil only differ by a chord scale. Safe to call
+	// concurrently; the reference stays valid for the aerofoil's lifetime.
+	const std::vector<double>& get_unit_camber(int n, const utils::Spacing& spacing = {});
 
-	nc::NdArray<double> get_camber_points(int n, double chord);
+	nc::NdArray<double> get_camber_points(int n, double chord, const utils::Spacing& spacing = {});
 	const std::string get_filepath() const { return filepath; }
 };
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include <pch.h>
+
+#include <cctype>
+#include <cstring>
+
+#include <aerofoillibrary.hpp>
+#include <utils/hash.hpp>
+#include <utils/mapped_file.hpp>
+#include <utils/parallel.hpp>
+#include <utils/text.hpp>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr char magic[8]{ 'V', 'L', 'M', 'F', 'O', 'I', 'L', '\1' };
+    constexpr std::size_t alignment{ 64 };
+    const char* const packName{ "aerofoils.pack" };
+
+    std::size_t aligned(std::size_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    std::int64_t modified(const fs::path& path, std::error_code& err)
+    {
+        return (std::int64_t)fs::last_write_time(path, err).time_since_epoch().count();
+    }
+
+    bool isDat(const fs::path& path)
+    {
+        std::string extension{ path.extension().string() };
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return (char)std::tolower(c); });
+        return extension == ".dat";
+    }
+}
+
+AerofoilLibrary& AerofoilLibrary::shared()
+{
+    static AerofoilLibrary library;
+    return library;
+}
+
+/// <summary>
+/// Maps a pack and checks its index against the file size. Returns nullptr
+/// if there is no valid pack.
+/// </summary>
+std::shared_ptr<AerofoilLibrary::Directory> AerofoilLibrary::readPack(const fs::path& file)
+{
+    std::error_code err;
+    if (!fs::exists(file, err)) { return nullptr; }
+
+    std::shared_ptr<utils::MappedFile> mapping;
+    try {
+        mapping = std::make_shared<utils::MappedFile>(file.string());
+    }
+    catch (const std::runtime_error&) {
+        return nullptr;
+    }
+
+    const std::size_t size{ mapping->size() };
+    if (size < sizeof(Header)) { return nullptr; }
+
+    Header header;
+    std::memcpy(&header, mapping->data(), sizeof(Header));
+    if (
+        std::memcmp(header.magic, magic, sizeof(magic)) != 0
+        || header.version != version
+        || sizeof(Header) + (std::uint64_t)header.nEntries * sizeof(PackEntry) > header.namesOffset
+        || header.namesOffset > header.dataOffset
+        || header.dataOffset % alignment != 0
+        || header.dataOffset + header.dataSize * sizeof(double) != size
+        )
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<Directory> directory{ std::make_shared<Directory>() };
+    directory->entries.resize(header.nEntries);
+
+    for (std::uint32_t k{ 0 }; k != header.nEntries; k++)
+    {
+        PackEntry packed;
+        std::memcpy(&packed, mapping->data() + sizeof(Header) + k * sizeof(PackEntry), sizeof(PackEntry));
+
+        if (
+            header.namesOffset + packed.nameOffset + packed.nameLength > header.dataOffset
+            || packed.offset + 2 * (std::uint64_t)packed.rows > header.dataSize
+            )
+        {
+            return nullptr;
+        }
+
+        Entry& entry{ directory->entries[k] };
+        entry.file.assign(mapping->data() + header.namesOffset + packed.nameOffset, packed.nameLength);
+        entry.size = packed.size;
+        entry.mtime = packed.mtime;
+        entry.checksum = packed.checksum;
+        entry.offset = packed.offset;
+        entry.rows = packed.rows;
+    }
+
+    directory->data = reinterpret_cast<const double*>(mapping->data() + header.dataOffset);
+    directory->storage = std::move(mapping);
+    return directory;
+}
+
+bool AerofoilLibrary::writePack(const fs::path& file, const Directory& directory)
+{
+    std::string names;
+    std::vector<PackEntry> packed;
+    std::uint64_t dataSize{ 0 };
+    for (const Entry& entry : directory.entries)
+    {
+        PackEntry p{};
+        p.nameOffset = names.size();
+        p.nameLength = (std::uint32_t)entry.file.size();
+        p.rows = entry.rows;
+        p.size = entry.size;
+        p.mtime = entry.mtime;
+        p.checksum = entry.checksum;
+        p.offset = entry.offset;
+        packed.push_back(p);
+
+        names += entry.file;
+        dataSize = std::max(dataSize, entry.offset + 2 * (std::uint64_t)entry.rows);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.nEntries = (std::uint32_t)packed.size();
+    header.namesOffset = sizeof(Header) + packed.size() * sizeof(PackEntry);
+    header.dataOffset = aligned(header.namesOffset + names.size());
+    header.dataSize = dataSize;
+
+    // Unique temporary name per writer.
+    static std::atomic<std::uint64_t> counter{ 0 };
+    std::uint64_t unique{ std::random_device{}() ^ (counter++ << 32) };
+
+    fs::path tmp{ file };
+    tmp += "." + std::to_string(unique) + ".tmp";
+
+    {
+        std::ofstream f{ tmp, std::ios::binary };
+        const char zeros[alignment]{};
+
+        f.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        f.write(reinterpret_cast<const char*>(packed.data()), (std::streamsize)(packed.size() * sizeof(PackEntry)));
+        f.write(names.data(), (std::streamsize)names.size());
+        f.write(zeros, (std::streamsize)(header.dataOffset - header.namesOffset - names.size()));
+        f.write(reinterpret_cast<const char*>(directory.data), (std::streamsize)(dataSize * sizeof(double)));
+
+        if (!f) {
+            f.close();
+            std::error_code err;
+            fs::remove(tmp, err);
+            return false;
+        }
+    }
+
+    std::error_code err;
+    fs::rename(tmp, file, err);
+    if (err) {
+        fs::remove(tmp, err);
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Indexes the .dat files of a directory against its pack. Entries whose
+/// file size and modification time match the pack are reused; the rest are
+/// parsed concurrently and the pack is rewritten. A pack that cannot be
+/// written is reported and only costs the next process the parse.
+/// </summary>
+std::shared_ptr<AerofoilLibrary::Directory> AerofoilLibrary::scan(const fs::path& path, int nThreads)
+{
+    std::error_code err;
+    std::vector<Entry> entries;
+    for (const fs::directory_entry& item : fs::directory_iterator{ path, err })
+    {
+        std::error_code item_err;
+        if (!item.is_regular_file(item_err) || !isDat(item.path())) { continue; }
+
+        Entry entry;
+        entry.file = item.path().filename().string();
+        entry.path = item.path().string();
+        entry.size = item.file_size(item_err);
+        entry.mtime = modified(item.path(), item_err);
+        if (item_err) { continue; }
+
+        entries.push_back(entry);
+    }
+    if (err) {
+        throw std::runtime_error("Aerofoil library not found: " + path.string());
+    }
+
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.file < b.file; });
+
+    // Match against the existing pack.
+    const fs::path packFile{ path / packName };
+    std::shared_ptr<Directory> pack{ readPack(packFile) };
+
+    std::map<std::string, const Entry*> packed;
+    if (pack) {
+        for (const Entry& entry : pack->entries) { packed[entry.file] = &entry; }
+    }
+
+    std::vector<const Entry*> reuse(entries.size(), nullptr);
+    std::vector<int> parse;
+    for (int k{ 0 }; k != (int)entries.size(); k++)
+    {
+        auto it{ packed.find(entries[k].file) };
+        if (it != packed.end() && it->second->size == entries[k].size && it->second->mtime == entries[k].mtime) {
+            reuse[k] = it->second;
+        }
+        else {
+            parse.push_back(k);
+        }
+    }
+
+    if (pack && parse.empty() && pack->entries.size() == entries.size())
+    {
+        for (int k{ 0 }; k != (int)entries.size(); k++) { pack->entries[k].path = entries[k].path; }
+        return pack;
+    }
+
+    // Preprocess new and modified files.
+    std::vector<std::vector<double>> lines(entries.size());
+    utils::parallelFor((int)parse.size(), [&](int first, int last)
+    {
+        std::string bytes;
+        for (int p{ first }; p != last; p++)
+        {
+            Entry& entry{ entries[parse[p]] };
+            if (utils::readText(entry.path, bytes)) {
+                entry.checksum = utils::fnv1a(bytes.data(), bytes.size());
+            }
+
+            // Files that cannot be loaded keep no camber line, so loading
+            // them reports the error at first use.
+            try {
+                Aerofoil aerofoil{ entry.path };
+                lines[parse[p]] = aerofoil.get_unit_camber_line();
+            }
+            catch (const std::exception&) {
+                lines[parse[p]].clear();
+            }
+        }
+    }, nThreads, 1);
+
+    std::shared_ptr<std::vector<double>> data{ std::make_shared<std::vector<double>>() };
+    for (int k{ 0 }; k != (int)entries.size(); k++)
+    {
+        Entry& entry{ entries[k] };
+        entry.offset = data->size();
+
+        if (reuse[k] != nullptr) {
+            entry.checksum = reuse[k]->checksum;
+            entry.rows = reuse[k]->rows;
+            const double* line{ pack->data + reuse[k]->offset };
+            data->insert(data->end(), line, line + 2 * (std::size_t)entry.rows);
+        }
+        else {
+            entry.rows = (std::uint32_t)(lines[k].size() / 2);
+            data->insert(data->end(), lines[k].begin(), lines[k].end());
+        }
+    }
+
+    // Reused lines are copied out, so unmap the old pack - a mapped file
+    // cannot be replaced on Windows.
+    packed.clear();
+    reuse.clear();
+    pack.reset();
+
+    std::shared_ptr<Directory> directory{ std::make_shared<Directory>() };
+    directory->entries = std::move(entries);
+    directory->data = data->data();
+    directory->storage = std::move(data);
+
+    if (!writePack(packFile, *directory)) {
+        std::cout << "Warning: Could not write aerofoil library pack '" << packFile.string()
+            << "'. Modified aerofoils will be parsed again on the next run.\n";
+    }
+
+    return directory;
+}
+
+std::vector<AerofoilLibrary::Entry> AerofoilLibrary::addDirectory(const std::string& directory, int nThreads)
+{
+    std::error_code err;
+    fs::path path{ fs::weakly_canonical(directory, err) };
+    if (err) { path = directory; }
+
+    std::lock_guard<std::mutex> lock{ mutex };
+
+    auto it{ directories.find(path.string()) };
+    if (it != directories.end()) { return it->second->entries; }
+
+    std::shared_ptr<Directory> added{ scan(path, nThreads) };
+    directories[path.string()] = added;
+
+    // Earlier directories win name clashes.
+    for (int k{ 0 }; k != (int)added->entries.size(); k++)
+    {
+        const Entry& entry{ added->entries[k] };
+        byName.insert({ entry.file, { added, k } });
+        byName.insert({ fs::path{ entry.file }.stem().string(), { added, k } });
+        byPath[entry.path] = { added, k };
+    }
+
+    return added->entries;
+}
+
+std::shared_ptr<Aerofoil> AerofoilLibrary::get(const std::string& reference)
+{
+    std::lock_guard<std::mutex> lock{ mutex };
+
+    // A path, else a library file name.
+    std::error_code err;
+    fs::path path{ reference };
+    if (!fs::is_regular_file(path, err)) {
+        auto it{ byName.find(reference) };
+        if (it != byName.end()) { path = it->second.first->entries[it->second.second].path; }
+    }
+
+    // Else an analytic camber line (NACA, CST). Not registered: they are
+    // cheap to rebuild, and optimisation loops make a new one per candidate.
+    AnalyticCamber camber;
+    if (!fs::is_regular_file(path, err) && AnalyticCamber::parse(reference, camber)) {
+        return std::make_shared<Aerofoil>(camber);
+    }
+
+    std::string key{ reference };
+    std::uint64_t size{ 0 };
+    std::int64_t mtime{ 0 };
+    if (fs::is_regular_file(path, err)) {
+        fs::path canonical{ fs::weakly_canonical(path, err) };
+        if (!err) { path = canonical; }
+
+        key = path.string();
+        size = fs::file_size(path, err);
+        mtime = modified(path, err);
+    }
+
+    // Shared unless the file changed since it was handed out.
+    auto loaded{ aerofoils.find(key) };
+    if (loaded != aerofoils.end() && loaded->second.size == size && loaded->second.mtime == mtime) {
+        return loaded->second.aerofoil;
+    }
+
+    std::shared_ptr<Aerofoil> aerofoil;
+
+    auto packed{ byPath.find(key) };
+    if (packed != byPath.end())
+    {
+        const Directory& directory{ *packed->second.first };
+        const Entry& entry{ directory.entries[packed->second.second] };
+        if (entry.size == size && entry.mtime == mtime && entry.rows > 0) {
+            aerofoil = std::make_shared<Aerofoil>(
+                entry.path, directory.storage, directory.data + entry.offset, (int)entry.rows
+            );
+        }
+    }
+
+    if (!aerofoil) {
+        aerofoil = std::make_shared<Aerofoil>(size != 0 ? key : reference, true);
+    }
+
+    aerofoils[key] = { aerofoil, size, mtime };
+    return aerofoil;
+}
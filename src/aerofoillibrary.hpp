@@ -0,0 +1,107 @@
+#pragma once
+
+#include <pch.h>
+
+#include <map>
+#include <filesystem>
+
+#include <aerofoil.hpp>
+
+/// <summary>
+/// Process-wide registry of aerofoils. Every Plane resolves its sections'
+/// aerofoil references here, so each aerofoil is read once per process and
+/// shared by all planes and wings that use it. Aerofoils are handed out
+/// unloaded and read on first use; a file that has changed on disk since
+/// (size or modification time) is read again.
+///
+/// Library directories of .dat files can be added. Each keeps a pack file
+/// (aerofoils.pack) with an index and the preprocessed unit chord camber
+/// lines of all its aerofoils, so loading one is a copy out of the mapped
+/// pack instead of parsing and splitting surfaces. Only new or modified
+/// files are parsed when a pack is refreshed. Library aerofoils can be
+/// referenced by file name with or without ".dat" ("naca2412").
+///
+/// Pack layout (native byte order):
+///     Header
+///     PackEntry[nEntries]     sorted by file name
+///     file names              (not terminated)
+///     camber lines            double, rows x 2 per entry; block starts
+///                             64-byte aligned (cache line)
+/// </summary>
+class AerofoilLibrary {
+public:
+    static constexpr std::uint32_t version{ 1 };
+
+    struct Entry {
+        std::string file;           // file name, e.g. naca2412.dat
+        std::string path;           // canonical path
+        std::uint64_t size{ 0 };
+        std::int64_t mtime{ 0 };
+        std::uint64_t checksum{ 0 };    // FNV-1a of the file bytes
+        std::uint64_t offset{ 0 };  // camber line offset in the data block (doubles)
+        std::uint32_t rows{ 0 };    // camber line points, 0 if it failed to load
+    };
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t nEntries;
+        std::uint64_t namesOffset;
+        std::uint64_t dataOffset;
+        std::uint64_t dataSize;     // doubles
+    };
+
+    struct PackEntry {
+        std::uint64_t nameOffset;
+        std::uint32_t nameLength;
+        std::uint32_t rows;
+        std::uint64_t size;
+        std::int64_t mtime;
+        std::uint64_t checksum;
+        std::uint64_t offset;
+    };
+
+    struct Directory {
+        std::vector<Entry> entries;
+        std::shared_ptr<const void> storage;    // pack mapping or in-memory data
+        const double* data{ nullptr };
+    };
+
+    struct Loaded {
+        std::shared_ptr<Aerofoil> aerofoil;
+        std::uint64_t size{ 0 };
+        std::int64_t mtime{ 0 };
+    };
+
+    std::map<std::string, std::shared_ptr<Directory>> directories;  // by canonical path
+    std::map<std::string, std::pair<std::shared_ptr<Directory>, int>> byName;
+    std::map<std::string, std::pair<std::shared_ptr<Directory>, int>> byPath;
+    std::map<std::string, Loaded> aerofoils;    // by canonical path or reference
+
+    std::mutex mutex;
+
+    static std::shared_ptr<Directory> readPack(const std::filesystem::path& file);
+    static bool writePack(const std::filesystem::path& file, const Directory& directory);
+    std::shared_ptr<Directory> scan(const std::filesystem::path& directory, int nThreads);
+
+public:
+    AerofoilLibrary() = default;
+
+    AerofoilLibrary(const AerofoilLibrary&) = delete;
+    AerofoilLibrary& operator=(const AerofoilLibrary&) = delete;
+
+    static AerofoilLibrary& shared();
+
+    // Adds a directory of .dat files, building or refreshing its pack. A
+    // directory already added is not scanned again. nThreads: worker
+    // threads for parsing (0: all cores). Returns the directory's index.
+    std::vector<Entry> addDirectory(const std::string& directory, int nThreads = 0);
+
+    // Aerofoil by file path, library file name or analytic camber line
+    // (see AnalyticCamber, a new instance per call), in that order,
+    // unloaded. Unknown references give an aerofoil that falls back to a
+    // flat plate when loaded, as a missing file does.
+    std::shared_ptr<Aerofoil> get(const std::string& reference);
+
+};
@@ -0,0 +1,195 @@
+#include <pch.h>
+
+#include <cctype>
+
+#include <analyticcamber.hpp>
+
+namespace
+{
+	// NACA 5-digit mean line constants for a design cl of 0.3, by P:
+	// { r, k1, k2/k1 }. Abbott & von Doenhoff; reflexed lines start at P = 2.
+	constexpr double standard[5][3]{
+		{ 0.0580, 361.400, 0 },
+		{ 0.1260, 51.640, 0 },
+		{ 0.2025, 15.957, 0 },
+		{ 0.2900, 6.643, 0 },
+		{ 0.3910, 3.230, 0 }
+	};
+	constexpr double reflexed[5][3]{
+		{ 0, 0, 0 },
+		{ 0.1300, 51.990, 0.000764 },
+		{ 0.2170, 15.793, 0.00677 },
+		{ 0.3180, 6.520, 0.0303 },
+		{ 0.4410, 3.191, 0.1355 }
+	};
+}
+
+bool AnalyticCamber::parse(const std::string& reference, AnalyticCamber& camber)
+{
+	if (!reference.empty() && reference.front() == '{')
+	{
+		nlohmann::json j = nlohmann::json::parse(reference, nullptr, false);
+		if (j.is_discarded() || !j.is_object()) { return false; }
+
+		auto type{ j.find("type") };
+		if (type == j.end() || !type->is_string() || type->get<std::string>() != "cst") { return false; }
+
+		camber = fromCst(j, reference);
+		return true;
+	}
+
+	// "NACA" [" "] digits
+	if (reference.size() < 4) { return false; }
+	std::string prefix{ reference.substr(0, 4) };
+	std::transform(prefix.begin(), prefix.end(), prefix.begin(),
+		[](unsigned char c) { return (char)std::toupper(c); });
+	if (prefix != "NACA") { return false; }
+
+	std::string digits{ reference.substr(reference.size() > 4 && reference[4] == ' ' ? 5 : 4) };
+	if (
+		(digits.size() != 4 && digits.size() != 5)
+		|| !std::all_of(digits.begin(), digits.end(), [](unsigned char c) { return std::isdigit(c); })
+		)
+	{
+		return false;
+	}
+
+	camber = naca(digits, reference);
+	return true;
+}
+
+AnalyticCamber AnalyticCamber::naca(const std::string& digits, const std::string& reference)
+{
+	AnalyticCamber camber;
+	camber.name = "NACA" + digits;
+
+	if (digits.size() == 4)
+	{
+		camber.type = Type::naca4;
+		camber.m = (digits[0] - '0') / 100.0;
+		camber.p = (digits[1] - '0') / 10.0;
+
+		if (camber.m != 0 && camber.p == 0) {
+			throw std::invalid_argument("Aerofoil '" + reference + "': cambered NACA 4-digit needs a max camber position.");
+		}
+		return camber;
+	}
+
+	const int L{ digits[0] - '0' };
+	const int P{ digits[1] - '0' };
+	const int S{ digits[2] - '0' };
+
+	camber.type = Type::naca5;
+	camber.reflex = S == 1;
+	if (S > 1 || P < 1 || P > 5 || (camber.reflex && P < 2)) {
+		throw std::invalid_argument("Aerofoil '" + reference + "': no NACA 5-digit mean line.");
+	}
+
+	const double* row{ camber.reflex ? reflexed[P - 1] : standard[P - 1] };
+	camber.r = row[0];
+	camber.k1 = row[1] * L / 2.0;	// tabulated for L = 2
+	camber.k21 = row[2];
+	return camber;
+}
+
+AnalyticCamber AnalyticCamber::fromCst(const nlohmann::json& j, const std::string& reference)
+{
+	// Coefficient list, empty if missing or not all numbers.
+	auto coefficients = [&](const char* key) {
+		std::vector<double> values;
+		auto it{ j.find(key) };
+		if (it == j.end() || !it->is_array()) { return values; }
+		for (const nlohmann::json& value : *it) {
+			if (!value.is_number()) { return std::vector<double>{}; }
+			values.push_back(value.get<double>());
+		}
+		return values;
+	};
+
+	std::vector<double> upper{ coefficients("upper") };
+	std::vector<double> lower{ coefficients("lower") };
+	if (upper.empty() || upper.size() != lower.size()) {
+		throw std::invalid_argument(
+			"Aerofoil '" + reference + "': CST needs equal, non-empty upper and lower lists of numbers."
+		);
+	}
+
+	AnalyticCamber camber;
+	camber.type = Type::cst;
+	camber.name = reference;
+
+	const int order{ (int)upper.size() - 1 };
+	camber.cst.resize(upper.size());
+	double binomial{ 1 };
+	for (int i{ 0 }; i <= order; i++)
+	{
+		camber.cst[i] = binomial * 0.5 * (upper[i] + lower[i]);
+		binomial = binomial * (order - i) / (i + 1);
+	}
+	return camber;
+}
+
+void AnalyticCamber::evaluate(const double* x, double* z, int n) const
+{
+	switch (type)
+	{
+	case Type::naca4:
+	{
+		if (m == 0) {
+			std::fill(z, z + n, 0.0);
+			return;
+		}
+
+		const double front{ m / (p * p) };
+		const double back{ m / ((1 - p) * (1 - p)) };
+		for (int i{ 0 }; i != n; i++)
+		{
+			const double xi{ x[i] };
+			const double zc{ 2 * p * xi - xi * xi };
+			z[i] = xi < p ? front * zc : back * (1 - 2 * p + zc);
+		}
+		return;
+	}
+	case Type::naca5:
+	{
+		const double r3{ r * r * r };
+		const double tail{ k21 * (1 - r) * (1 - r) * (1 - r) };
+		for (int i{ 0 }; i != n; i++)
+		{
+			const double xi{ x[i] };
+			const double d{ xi - r };
+			if (reflex) {
+				z[i] = k1 / 6 * ((xi < r ? d * d * d : k21 * d * d * d) - tail * xi - r3 * xi + r3);
+			}
+			else {
+				z[i] = xi < r
+					? k1 / 6 * (xi * xi * xi - 3 * r * xi * xi + r * r * (3 - r) * xi)
+					: k1 * r3 / 6 * (1 - xi);
+			}
+		}
+		return;
+	}
+	case Type::cst:
+	{
+		// Horner's scheme in x and 1 - x:
+		//     sum_k c_k x^k s^(N-k) = (((c_N x + c_(N-1) s) x + c_(N-2) s^2) x ...
+		// with s^k carried along, one multiply-add per coefficient and no
+		// pow. Stations inner, so each pass is a contiguous loop.
+		const int order{ (int)cst.size() - 1 };
+		std::vector<double> s_k(n, 1.0);
+		std::fill(z, z + n, cst[order]);
+		for (int k{ order - 1 }; k >= 0; k--)
+		{
+			for (int i{ 0 }; i != n; i++)
+			{
+				s_k[i] *= 1 - x[i];
+				z[i] = z[i] * x[i] + cst[k] * s_k[i];
+			}
+		}
+		for (int i{ 0 }; i != n; i++) {
+			z[i] *= std::sqrt(x[i]) * (1 - x[i]);
+		}
+		return;
+	}
+	}
+}
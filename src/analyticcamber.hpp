@@ -0,0 +1,57 @@
+#pragma once
+
+#include <pch.h>
+
+/// <summary>
+/// Camber line of an analytic aerofoil family, evaluated at chordwise
+/// stations instead of read from a .dat file. A section's "aerofoil" may be
+///     "NACA2412"      4-digit: max camber m = 2% at p = 40% chord
+///     "NACA23012"     5-digit LPSTT: design cl = 0.15 L, max camber near
+///                     P/20 chord, S = 1 for the reflexed mean line
+///     { "type": "cst", "upper": [...], "lower": [...] }
+///                     CST surfaces (class function sqrt(x) (1 - x), equal
+///                     Bernstein orders); the camber line is their mean
+/// Thickness digits are ignored - only the camber line is used. Names are
+/// case insensitive and may have a space after "NACA".
+/// </summary>
+class AnalyticCamber
+{
+public:
+	enum class Type { naca4, naca5, cst };
+
+private:
+	Type type{ Type::naca4 };
+	std::string name;
+
+	// NACA 4-digit
+	double m{ 0 };
+	double p{ 0 };
+
+	// NACA 5-digit mean line: transition point r, k1 and k2/k1 scaled to
+	// the design lift.
+	double r{ 0 };
+	double k1{ 0 };
+	double k21{ 0 };
+	bool reflex{ false };
+
+	// CST: mean of the upper and lower coefficients times the Bernstein
+	// binomial coefficients.
+	std::vector<double> cst;
+
+	static AnalyticCamber naca(const std::string& digits, const std::string& reference);
+	static AnalyticCamber fromCst(const nlohmann::json& j, const std::string& reference);
+
+public:
+	// Parses a section "aerofoil" reference (CST objects as dumped JSON).
+	// Returns false if it does not name an analytic family; throws
+	// std::invalid_argument if it names one with invalid parameters.
+	static bool parse(const std::string& reference, AnalyticCamber& camber);
+
+	/// <summary>
+	/// Camber z at n unit chord stations x (0 to 1). z is 0 at both ends.
+	/// </summary>
+	void evaluate(const double* x, double* z, int n) const;
+
+	Type get_type() const { return type; }
+	const std::string& get_name() const { return name; }
+};
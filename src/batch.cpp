@@ -0,0 +1,191 @@
+#include <pch.h>
+
+#include <batch.hpp>
+#include <plane.hpp>
+#include <vlm.hpp>
+#include <freewake.hpp>
+#include <aerofoillibrary.hpp>
+
+using json = nlohmann::json;
+
+void MemoryBudget::acquire(std::size_t bytes)
+{
+    std::unique_lock<std::mutex> lock{ mutex };
+
+    // An oversized case waits for the pool to drain then runs alone.
+    released.wait(lock, [&] { return used == 0 || used + bytes <= budget; });
+    used += bytes;
+}
+
+void MemoryBudget::release(std::size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        used -= bytes;
+    }
+    released.notify_all();
+}
+
+Batch::Batch(std::ifstream& manifest)
+{
+    read_manifest(manifest);
+}
+
+/// <summary>
+/// Reads batch manifest. See batch.hpp for layout.
+/// </summary>
+/// <param name="file"> {std::ifstream}: Input .json filestream.</param>
+void Batch::read_manifest(std::ifstream& file)
+{
+    json j_manifest = json::parse(file);
+    file.close();
+
+    int hardware_threads{ (int)std::thread::hardware_concurrency() };
+    nThreads = j_manifest.value("threads", std::max(hardware_threads, 1));
+    nThreads = std::max(nThreads, 1);
+
+    double memory_mb = j_manifest.value("memory_mb", 4096.0);
+    memoryBudget = (std::size_t)(memory_mb * 1024 * 1024);
+
+    cacheDir = j_manifest.value("cache_dir", "");
+    if (!cacheDir.empty()) {
+        double quota_mb = j_manifest.value("cache_quota_mb", 10240.0);
+        solveCache = std::make_unique<SolveCache>(cacheDir, (std::uintmax_t)(quota_mb * 1024 * 1024));
+    }
+
+    // Shared by every case, see AerofoilLibrary.
+    if (j_manifest.contains("aerofoil_library")) {
+        AerofoilLibrary::shared().addDirectory(j_manifest["aerofoil_library"].get<std::string>(), nThreads);
+    }
+
+    for (auto& j_case : j_manifest["cases"]) {
+        BatchCase c;
+
+        c.planeFile = j_case["plane"];
+        c.name = j_case.value("name", c.planeFile);
+        c.Qinf = j_case.value("Qinf", c.Qinf);
+        c.alpha = j_case.value("alpha", c.alpha);
+        c.beta = j_case.value("beta", c.beta);
+        c.rho = j_case.value("rho", c.rho);
+        c.viscous = j_case.value("viscous", c.viscous);
+
+        std::string lattice = j_case.value("lattice", "horseshoe");
+        if (lattice == "ring") { c.ring = true; }
+        else if (lattice != "horseshoe") {
+            throw std::invalid_argument("Unknown lattice: " + lattice);
+        }
+
+        std::string wake = j_case.value("wake", "fixed");
+        if (wake == "free") { c.freeWake = true; }
+        else if (wake != "fixed") {
+            throw std::invalid_argument("Unknown wake: " + wake);
+        }
+
+        cases.push_back(c);
+    }
+}
+
+/// <summary>
+/// Runs all cases on the worker pool. Records are written to out in order of
+/// completion, one JSON object per line.
+/// </summary>
+void Batch::run(std::ostream& out)
+{
+    MemoryBudget budget{ memoryBudget };
+    std::atomic<int> next{ 0 };
+
+    auto worker = [&]() {
+        for (int i{ next++ }; i < nCases(); i = next++) {
+            runCase(i, budget, out);
+        }
+    };
+
+    int n_workers{ std::min(nThreads, std::max(nCases(), 1)) };
+
+    std::vector<std::thread> workers;
+    for (int i{ 0 }; i != n_workers; i++) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+/// <summary>
+/// Meshes and solves a single case. Any exception thrown while reading the
+/// plane, its aerofoils or solving is caught and written to the record.
+/// </summary>
+void Batch::runCase(int index, MemoryBudget& budget, std::ostream& out)
+{
+    const BatchCase& c{ cases[index] };
+
+    json record;
+    record["case"] = index;
+    record["name"] = c.name;
+    record["plane"] = c.planeFile;
+
+    auto start{ std::chrono::high_resolution_clock::now() };
+    try {
+        std::ifstream f{ c.planeFile };
+        if (f.fail()) {
+            throw std::runtime_error("Plane file not found: " + c.planeFile);
+        }
+
+        Plane plane{ f, 1, cacheDir };
+        const int N{ plane.mesh->nPanels };
+
+        // Mesh is cheap - only the N^2 solve is held back by the budget.
+        MemoryBudget::Lease lease{ budget, Vlm::memoryEstimate(N) };
+
+        record["status"] = "ok";
+        record["panels"] = N;
+        if (!cacheDir.empty()) { record["mesh_cached"] = plane.meshCached; }
+
+        if (c.freeWake)
+        {
+            // One thread per case, as for the plane.
+            FreeWake::Options options;
+            options.nThreads = 1;
+            FreeWake freeWake{ &plane, options };
+            freeWake.run(c.Qinf, c.alpha, c.beta, c.rho);
+
+            record["CL"] = freeWake.getVlm().CL;
+            record["CDi"] = freeWake.getVlm().CDi;
+            record["wake_sweeps"] = freeWake.sweeps.size();
+            record["wake_converged"] = freeWake.converged;
+        }
+        else
+        {
+            Vlm vlm{ &plane, false };
+            vlm.setThreads(1);
+            vlm.setSolveCache(solveCache.get());
+            if (c.viscous) { vlm.runViscous(c.Qinf, c.alpha, c.beta, c.rho); }
+            else if (c.ring) { vlm.runRing(c.Qinf, c.alpha, c.beta, c.rho); }
+            else { vlm.runHorseshoe(c.Qinf, c.alpha, c.beta, c.rho); }
+
+            record["CL"] = vlm.CL;
+            record["CDi"] = vlm.CDi;
+            if (solveCache) { record["solve_cached"] = vlm.solveCached; }
+            if (c.viscous) {
+                int n_stalled{ 0 };
+                for (const Vlm::Strip& strip : vlm.strips) { n_stalled += strip.stalled; }
+
+                record["CDv"] = vlm.CDv;
+                record["viscous_converged"] = vlm.viscousConverged;
+                record["viscous_iterations"] = vlm.viscousIterations;
+                record["stalled_strips"] = n_stalled;
+            }
+        }
+    }
+    catch (const std::exception& err) {
+        record["status"] = "failed";
+        record["error"] = err.what();
+    }
+    auto stop{ std::chrono::high_resolution_clock::now() };
+
+    record["time_ms"] =
+        std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+
+    std::lock_guard<std::mutex> lock{ outMutex };
+    out << record.dump() << std::endl;
+}
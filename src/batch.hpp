@@ -0,0 +1,104 @@
+#pragma once
+
+#include <pch.h>
+
+#include <solvecache.hpp>
+
+/// <summary>
+/// Caps the total bytes held by concurrently running cases. A case larger
+/// than the whole budget is still allowed to run, but only on its own.
+/// </summary>
+class MemoryBudget {
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    const std::size_t budget;
+    std::size_t used{ 0 };
+
+public:
+    MemoryBudget(std::size_t budget) : budget{ budget } {};
+
+    void acquire(std::size_t bytes);
+    void release(std::size_t bytes);
+
+    // Holds a reservation for the lifetime of a case, including when the
+    // case throws.
+    class Lease {
+    private:
+        MemoryBudget& budget;
+        const std::size_t bytes;
+
+    public:
+        Lease(MemoryBudget& budget, std::size_t bytes)
+            : budget{ budget }
+            , bytes{ bytes }
+        {
+            budget.acquire(bytes);
+        }
+
+        ~Lease() { budget.release(bytes); }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+    };
+};
+
+/// <summary>
+/// Single plane + flight condition read from a batch manifest.
+/// </summary>
+struct BatchCase {
+    std::string name;
+    std::string planeFile;
+    double Qinf{ 1 };
+    double alpha{ 0 };
+    double beta{ 0 };
+    double rho{ 1.225 };
+    bool viscous{ false };
+    bool ring{ false };
+    bool freeWake{ false };
+};
+
+/// <summary>
+/// Headless driver for many plane files. Cases are pulled from the manifest
+/// by a fixed pool of worker threads and one JSON record is written per case
+/// as soon as it finishes. A failing case is reported and skipped.
+///
+/// Manifest layout:
+/// {
+///     "threads": 4,           (optional, defaults to hardware threads)
+///     "memory_mb": 4096,      (optional, cap on concurrent N^2 matrices)
+///     "cache_dir": "cache",   (optional, mesh and solve cache directory,
+///                              see MeshCache and SolveCache)
+///     "cache_quota_mb": 10240,    (optional, disk quota of the solve cache)
+///     "aerofoil_library": "aerofoils",  (optional, see AerofoilLibrary)
+///     "cases": [
+///         { "name": "cruise", "plane": "wing.json",
+///           "Qinf": 1, "alpha": 5, "beta": 0, "rho": 1.225,
+///           "viscous": false, "lattice": "horseshoe", "wake": "fixed" }
+///     ]
+/// }
+/// viscous cases use Vlm::runViscous and need section polars in the plane.
+/// lattice: horseshoe | ring (inviscid cases only).
+/// wake: fixed | free (force-free ring lattice wake, see FreeWake).
+/// </summary>
+class Batch {
+private:
+    std::vector<BatchCase> cases;
+    int nThreads;
+    std::size_t memoryBudget;
+    std::string cacheDir;
+    std::unique_ptr<SolveCache> solveCache;
+
+    std::mutex outMutex;
+
+    void read_manifest(std::ifstream& file);
+    void runCase(int index, MemoryBudget& budget, std::ostream& out);
+
+public:
+    Batch(std::ifstream& manifest);
+
+    void run(std::ostream& out);
+
+    const int nCases() const { return (int)cases.size(); }
+
+};
@@ -0,0 +1,197 @@
+#include <pch.h>
+
+#include <convergence.hpp>
+#include <batch.hpp>
+#include <vlm.hpp>
+
+using json = nlohmann::json;
+
+ConvergenceStudy::ConvergenceStudy(std::ifstream& spec)
+{
+    read_spec(spec);
+}
+
+/// <summary>
+/// Reads the study spec and the input plane. See convergence.hpp for layout.
+/// </summary>
+/// <param name="file"> {std::ifstream}: Input .json filestream.</param>
+void ConvergenceStudy::read_spec(std::ifstream& file)
+{
+    json j_spec = json::parse(file);
+    file.close();
+
+    std::string plane_file = j_spec["plane"];
+    std::ifstream f{ plane_file };
+    if (f.fail()) {
+        throw std::runtime_error("Plane file not found: " + plane_file);
+    }
+    nominal = std::make_unique<Plane>(f);
+
+    int hardware_threads{ (int)std::thread::hardware_concurrency() };
+    nThreads = std::max(j_spec.value("threads", std::max(hardware_threads, 1)), 1);
+    memoryBudget = (std::size_t)(j_spec.value("memory_mb", 4096.0) * 1024 * 1024);
+
+    Qinf = j_spec.value("Qinf", Qinf);
+    alpha = j_spec.value("alpha", alpha);
+    beta = j_spec.value("beta", beta);
+    rho = j_spec.value("rho", rho);
+
+    nLevels = j_spec.value("levels", nLevels);
+    factor = j_spec.value("factor", factor);
+
+    std::string lattice = j_spec.value("lattice", "horseshoe");
+    if (lattice == "ring") { ring = true; }
+    else if (lattice != "horseshoe") {
+        throw std::invalid_argument("Unknown lattice: " + lattice);
+    }
+
+    if (nLevels < 3) {
+        throw std::invalid_argument("A convergence study needs at least 3 levels.");
+    }
+    if (factor <= 1) {
+        throw std::invalid_argument("Refinement factor must be greater than 1.");
+    }
+}
+
+/// <summary>
+/// Copy of the input wings with n and every section's m multiplied by
+/// factor^level (rounded). Aerofoils and polars are shared, and custom
+/// spacings are resampled to the new panel counts.
+/// </summary>
+std::vector<std::unique_ptr<Wing>> ConvergenceStudy::levelWings(int level) const
+{
+    const double scale{ std::pow(factor, level) };
+    auto scaled = [scale](int count) {
+        return count == 0 ? 0 : std::max(1, (int)std::lround(count * scale));
+    };
+
+    std::vector<std::unique_ptr<Wing>> wings{ nominal->copyWings() };
+    for (std::unique_ptr<Wing>& wing : wings)
+    {
+        const int n{ scaled(wing->n) };
+
+        wing->m_sum = 0;
+        for (int s{ 0 }; s != (int)wing->sections.size(); s++)
+        {
+            Section& section{ wing->sections[s] };
+            section.chordwise = section.chordwise.resampled(wing->n, n);
+
+            if (s == 0) { continue; }
+            const int m{ scaled(section.m) };
+            section.spanwise = section.spanwise.resampled(section.m, m);
+            section.m = m;
+            wing->m_sum += m;
+        }
+        wing->n = n;
+    }
+
+    return wings;
+}
+
+/// <summary>
+/// Solves every level on a worker pool, finest first so the largest solve
+/// starts as early as possible, then extrapolates from the three finest.
+/// </summary>
+void ConvergenceStudy::run(std::ostream& out)
+{
+    auto start{ std::chrono::high_resolution_clock::now() };
+    auto seconds = [](std::chrono::high_resolution_clock::time_point t0) {
+        std::chrono::duration<double> dt{ std::chrono::high_resolution_clock::now() - t0 };
+        return dt.count();
+    };
+
+    levels.assign(nLevels, Level{});
+
+    // Levels run concurrently, each solve on its share of the threads.
+    const int n_workers{ std::min(nThreads, nLevels) };
+    const int level_threads{ std::max(nThreads / std::max(n_workers, 1), 1) };
+
+    MemoryBudget budget{ memoryBudget };
+    std::atomic<int> next{ 0 };
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        for (int i{ next++ }; i < nLevels; i = next++)
+        {
+            const int k{ nLevels - 1 - i };
+            Level& level{ levels[k] };
+            level.scale = std::pow(factor, k);
+
+            try {
+                auto solve_start{ std::chrono::high_resolution_clock::now() };
+
+                Plane plane{ levelWings(k), 1 };
+                level.panels = plane.mesh->nPanels;
+
+                // Mesh is cheap - only the N^2 solve is held back by the budget.
+                MemoryBudget::Lease lease{ budget, Vlm::memoryEstimate(level.panels) };
+
+                Vlm vlm{ &plane, false };
+                vlm.setThreads(level_threads);
+                if (ring) { vlm.runRing(Qinf, alpha, beta, rho); }
+                else { vlm.runHorseshoe(Qinf, alpha, beta, rho); }
+
+                level.CL = vlm.CL;
+                level.CDi = vlm.CDi;
+                level.solve_s = seconds(solve_start);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock{ outMutex };
+                if (!error) { error = std::current_exception(); }
+                continue;
+            }
+
+            json record;
+            record["level"] = k;
+            record["scale"] = level.scale;
+            record["panels"] = level.panels;
+            record["CL"] = level.CL;
+            record["CDi"] = level.CDi;
+            record["solve_s"] = level.solve_s;
+
+            std::lock_guard<std::mutex> lock{ outMutex };
+            out << record.dump() << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i{ 0 }; i != n_workers; i++) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    if (error) { std::rethrow_exception(error); }
+
+    // Three finest levels, fine to coarse.
+    std::array<double, 3> h, CL_k, CDi_k;
+    for (int i{ 0 }; i != 3; i++)
+    {
+        const Level& level{ levels[nLevels - 1 - i] };
+        h[i] = 1 / std::sqrt((double)level.panels);
+        CL_k[i] = level.CL;
+        CDi_k[i] = level.CDi;
+    }
+    CL = utils::richardson(CL_k, h);
+    CDi = utils::richardson(CDi_k, h);
+
+    auto extrapolation_json = [](const utils::Richardson& r) {
+        json j;
+        j["extrapolated"] = r.extrapolated;
+        j["error"] = r.error;
+        j["order"] = r.order;
+        j["gci"] = r.gci;
+        j["monotonic"] = r.monotonic;
+        return j;
+    };
+
+    json record;
+    record["summary"] = true;
+    record["panels"] = levels.back().panels;
+    record["CL"] = extrapolation_json(CL);
+    record["CDi"] = extrapolation_json(CDi);
+    record["elapsed_s"] = seconds(start);
+
+    out << record.dump() << std::endl;
+}
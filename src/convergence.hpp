@@ -0,0 +1,63 @@
+#pragma once
+
+#include <pch.h>
+
+#include <plane.hpp>
+#include <utils/richardson.hpp>
+
+/// <summary>
+/// Mesh convergence study of one plane at one flight condition. The plane is
+/// solved on levels whose panel counts (n and every section's m) are the
+/// input counts times factor^level; levels run concurrently within a memory
+/// budget and share the input plane's aerofoils and polars. CL and CDi of
+/// the three finest levels are Richardson extrapolated (see
+/// utils::richardson), with mesh size h = 1 / sqrt(N) for N panels.
+///
+/// Spec layout:
+/// {
+///     "plane": "wing.json", "Qinf": 1, "alpha": 5, "beta": 0, "rho": 1.225,
+///     "levels": 3, "factor": 2, "lattice": "horseshoe",
+///     "threads": 4, "memory_mb": 4096
+/// }
+/// lattice: horseshoe | ring. One JSON line is written per level as it
+/// finishes, then a summary line.
+/// </summary>
+class ConvergenceStudy {
+public:
+    struct Level {
+        double scale{ 1 };          // panel count multiplier per direction
+        int panels{ 0 };
+        double CL{ 0 };
+        double CDi{ 0 };
+        double solve_s{ 0 };
+    };
+
+private:
+    std::unique_ptr<Plane> nominal;
+
+    double Qinf{ 1 };
+    double alpha{ 0 };
+    double beta{ 0 };
+    double rho{ 1.225 };
+
+    int nLevels{ 3 };
+    double factor{ 2 };
+    bool ring{ false };
+    int nThreads{ 1 };
+    std::size_t memoryBudget{ 0 };
+
+    std::mutex outMutex;
+
+    void read_spec(std::ifstream& file);
+    std::vector<std::unique_ptr<Wing>> levelWings(int level) const;
+
+public:
+    std::vector<Level> levels;
+    utils::Richardson CL;
+    utils::Richardson CDi;
+
+    ConvergenceStudy(std::ifstream& spec);
+
+    void run(std::ostream& out);
+
+};
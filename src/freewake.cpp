@@ -0,0 +1,221 @@
+#include <pch.h>
+
+#include <freewake.hpp>
+#include <utils/treecode.hpp>
+
+using json = nlohmann::json;
+
+FreeWake::FreeWake(Plane* plane, Options options)
+    : plane{ plane }
+    , vlm{ plane, false }
+    , options{ options }
+{
+    if (this->options.nSegments < 1) {
+        throw std::invalid_argument("FreeWake: at least one segment per filament.");
+    }
+    if (this->options.length <= 0) { this->options.length = 2 * plane->b_ref; }
+
+    vlm.setThreads(this->options.nThreads);
+}
+
+/// <summary>
+/// Replaces each steady wake leg with a straight filament along the
+/// freestream. The leg itself is kept as the semi-infinite tail.
+/// </summary>
+void FreeWake::discretise()
+{
+    const int K{ options.nSegments };
+    ds = options.length / K;
+
+    const nc::NdArray<double>& V{ vlm.Qinf_vec };
+    double V_mod{ nc::norm(V)[0] };
+    std::array<double, 3> dir{ V[0] / V_mod, V[1] / V_mod, V[2] / V_mod };
+
+    filaments.clear();
+    nodes.clear();
+    for (int leg : lattice.legs)
+    {
+        double te[3]{ lattice.segments.x1[leg], lattice.segments.y1[leg], lattice.segments.z1[leg] };
+        for (int k{ 0 }; k <= K; k++) {
+            for (int d{ 0 }; d != 3; d++) { nodes.push_back(te[d] + k * ds * dir[d]); }
+        }
+
+        std::array<int, 2> columns{ lattice.columns[leg] };
+        std::array<double, 2> signs{ lattice.signs[leg] };
+
+        filaments.push_back(lattice.segments.size());
+        for (int k{ 0 }; k != K; k++)
+        {
+            lattice.segments.add(te, te);   // placed by updateSegments
+            lattice.columns.push_back(columns);
+            lattice.signs.push_back(signs);
+            lattice.trailing.push_back(true);
+        }
+    }
+
+    updateSegments();
+}
+
+/// <summary>
+/// Copies filament nodes into the lattice segments. Tails run from the last
+/// node 10 b_ref along the freestream, as the steady legs.
+/// </summary>
+void FreeWake::updateSegments()
+{
+    const int K{ options.nSegments };
+    utils::Segments& s{ lattice.segments };
+
+    const nc::NdArray<double>& V{ vlm.Qinf_vec };
+    double V_mod{ nc::norm(V)[0] };
+    double tail{ 10 * plane->b_ref };
+
+    for (int f{ 0 }; f != (int)filaments.size(); f++)
+    {
+        const double* p{ &nodes[3 * (size_t)f * (K + 1)] };
+
+        for (int k{ 0 }; k != K; k++)
+        {
+            int i{ filaments[f] + k };
+            s.x1[i] = p[3 * k]; s.y1[i] = p[3 * k + 1]; s.z1[i] = p[3 * k + 2];
+            s.x2[i] = p[3 * k + 3]; s.y2[i] = p[3 * k + 4]; s.z2[i] = p[3 * k + 5];
+        }
+
+        int leg{ lattice.legs[f] };
+        const double* end{ &p[3 * K] };
+        s.x1[leg] = end[0]; s.y1[leg] = end[1]; s.z1[leg] = end[2];
+        s.x2[leg] = end[0] + tail * V[0] / V_mod;
+        s.y2[leg] = end[1] + tail * V[1] / V_mod;
+        s.z2[leg] = end[2] + tail * V[2] / V_mod;
+    }
+}
+
+/// <summary>
+/// One relaxation step of every filament. Node velocities come from a tree
+/// code over all lattice and wake segments.
+/// </summary>
+/// <returns>Largest node displacement / segment length.</returns>
+double FreeWake::relax(double relaxation)
+{
+    const int K{ options.nSegments };
+    const int n_filaments{ (int)filaments.size() };
+    const int N{ plane->mesh->nPanels };
+
+    // Segment strengths from the vortex strengths (column N is zero).
+    std::vector<double> gamma(N + 1, 0);
+    for (int i{ 0 }; i != N; i++) { gamma[i] = vlm.vorticity[i]; }
+
+    const int S{ lattice.segments.size() };
+    std::vector<double> strengths(S);
+    for (int s{ 0 }; s != S; s++) {
+        strengths[s] = lattice.signs[s][0] * gamma[lattice.columns[s][0]]
+            + lattice.signs[s][1] * gamma[lattice.columns[s][1]];
+    }
+
+    utils::SegmentTree tree{ lattice.segments, strengths, options.leafSize };
+
+    const double delta{ options.coreRadius > 0 ? options.coreRadius : 0.25 * ds };
+    const nc::NdArray<double>& V{ vlm.Qinf_vec };
+
+    // Velocity at every node but the trailing edge ones.
+    std::vector<double> velocity(nodes.size(), 0);
+    const int n_nodes{ n_filaments * (K + 1) };
+
+    utils::parallelFor(n_nodes, [&](int first, int last)
+    {
+        for (int i{ first }; i != last; i++)
+        {
+            if (i % (K + 1) == 0) { continue; }
+
+            const double* p{ &nodes[3 * (size_t)i] };
+            std::array<double, 3> q{ tree.velocity(p[0], p[1], p[2], options.theta, delta) };
+            std::array<double, 3> q_m{ tree.velocity(p[0], -p[1], p[2], options.theta, delta) };
+
+            velocity[3 * i] = V[0] + q[0] + q_m[0];
+            velocity[3 * i + 1] = V[1] + q[1] - q_m[1];
+            velocity[3 * i + 2] = V[2] + q[2] + q_m[2];
+        }
+    }, options.nThreads);
+
+    // Re-march each filament from the trailing edge along the mean velocity
+    // of each segment.
+    double displacement{ 0 };
+    for (int f{ 0 }; f != n_filaments; f++)
+    {
+        double* p{ &nodes[3 * (size_t)f * (K + 1)] };
+        const double* v{ &velocity[3 * (size_t)f * (K + 1)] };
+
+        std::array<double, 3> prev{ p[0], p[1], p[2] };
+        for (int k{ 1 }; k <= K; k++)
+        {
+            std::array<double, 3> v_seg;
+            for (int d{ 0 }; d != 3; d++) {
+                v_seg[d] = k == 1 ? v[3 + d] : 0.5 * (v[3 * (k - 1) + d] + v[3 * k + d]);
+            }
+            double v_mod{ std::sqrt(v_seg[0] * v_seg[0] + v_seg[1] * v_seg[1] + v_seg[2] * v_seg[2]) };
+
+            double move2{ 0 };
+            for (int d{ 0 }; d != 3; d++)
+            {
+                double target{ prev[d] + ds * v_seg[d] / v_mod };
+                double step{ relaxation * (target - p[3 * k + d]) };
+                p[3 * k + d] += step;
+                move2 += step * step;
+                prev[d] = p[3 * k + d];
+            }
+            displacement = std::max(displacement, std::sqrt(move2) / ds);
+        }
+    }
+
+    updateSegments();
+    return displacement;
+}
+
+void FreeWake::run(
+    double Qinf, double alpha, double beta, double atmosphereDensity, std::ostream* log
+)
+{
+    vlm.setFreestream(Qinf, alpha, beta, atmosphereDensity);
+    lattice = vlm.ringLattice();
+    discretise();
+
+    // Flat (prescribed) wake to start from.
+    vlm.solve(lattice, nullptr);
+
+    sweeps.clear();
+    converged = false;
+    for (int k{ 1 }; k <= options.maxSweeps; k++)
+    {
+        auto start{ std::chrono::high_resolution_clock::now() };
+
+        Sweep sweep;
+        sweep.sweep = k;
+        sweep.displacement = relax(options.relaxation);
+
+        vlm.solve(lattice, &vlm);
+
+        std::chrono::duration<double, std::milli> dt{
+            std::chrono::high_resolution_clock::now() - start };
+        sweep.time_ms = dt.count();
+        sweep.refineIterations = vlm.refineIterations;
+        sweep.CL = vlm.CL;
+        sweep.CDi = vlm.CDi;
+        sweeps.push_back(sweep);
+
+        if (log != nullptr)
+        {
+            json record;
+            record["sweep"] = sweep.sweep;
+            record["displacement"] = sweep.displacement;
+            record["time_ms"] = sweep.time_ms;
+            record["refine_iterations"] = sweep.refineIterations;
+            record["CL"] = sweep.CL;
+            record["CDi"] = sweep.CDi;
+            *log << record.dump() << std::endl;
+        }
+
+        if (sweep.displacement < options.tolerance) {
+            converged = true;
+            break;
+        }
+    }
+}
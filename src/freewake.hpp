@@ -0,0 +1,76 @@
+#pragma once
+
+#include <pch.h>
+
+#include <plane.hpp>
+#include <vlm.hpp>
+
+/// <summary>
+/// Force-free steady wake on the ring lattice. Each trailing leg of the
+/// steady lattice becomes a filament of nSegments straight segments over
+/// length, ending in a semi-infinite leg along the freestream. Per sweep:
+///     1. velocity at every filament node (freestream + lattice + wake,
+///        with the mirror image) from a Barnes-Hut tree code,
+///     2. filaments are re-marched from the trailing edge along the local
+///        velocity and relaxed towards the new shape,
+///     3. vortex strengths are re-solved for the new wake, warm-started
+///        from the previous factorisation (see Vlm::refine).
+/// until the largest node displacement, relative to the segment length,
+/// falls below tolerance.
+/// </summary>
+class FreeWake {
+public:
+    struct Options {
+        int nSegments{ 40 };        // segments per filament
+        double length{ 0 };         // filament length (0: 2 b_ref)
+        double theta{ 0.5 };        // tree code opening angle (0: direct)
+        double coreRadius{ 0 };     // filament core (0: a quarter segment)
+        double relaxation{ 1 };
+        double tolerance{ 1e-3 };
+        int maxSweeps{ 50 };
+        int leafSize{ 16 };
+        int nThreads{ 0 };
+    };
+
+    struct Sweep {
+        int sweep{ 0 };
+        double displacement{ 0 };   // max node move / segment length
+        double time_ms{ 0 };
+        int refineIterations{ -1 }; // -1 if re-factorised
+        double CL{ 0 };
+        double CDi{ 0 };
+    };
+
+private:
+    Plane* plane;
+    Vlm vlm;
+    Options options;
+
+    Vlm::Lattice lattice;
+    std::vector<int> filaments;     // first segment of each filament
+    std::vector<double> nodes;      // (nSegments + 1) x 3 per filament
+    double ds{ 0 };
+
+    void discretise();
+    void updateSegments();
+    double relax(double relaxation);
+
+public:
+    bool converged{ false };
+    std::vector<Sweep> sweeps;
+
+    FreeWake(Plane* plane, Options options);
+    FreeWake(Plane* plane) : FreeWake(plane, Options{}) {}
+
+    // Relaxes the wake and solves. Writes a JSON line per sweep to log.
+    void run(
+        double Qinf, double alpha, double beta, double atmosphereDensity,
+        std::ostream* log = nullptr
+    );
+
+    const Vlm& getVlm() const { return vlm; }
+    int getFilamentCount() const { return (int)filaments.size(); }
+    // Filament nodes ((nSegments + 1) x 3 per filament, trailing edge first).
+    const std::vector<double>& getFilaments() const { return nodes; }
+
+};
@@ -4,23 +4,250 @@
 #include <mesh.hpp>
 #include <viewer.hpp>
 #include <vlm.hpp>
+#include <batch.hpp>
+#include <uq.hpp>
+#include <surrogate.hpp>
+#include <adaptive.hpp>
+#include <convergence.hpp>
+#include <unsteadyrun.hpp>
+#include <aerofoillibrary.hpp>
 
-int main()
+/// <summary>
+/// Headless batch mode: VLM --batch manifest.json [results.jsonl]
+/// </summary>
+int runBatch(int argc, char* argv[])
 {
+    std::ifstream manifest{ argv[2] };
+    if (manifest.fail()) {
+        std::cout << "Manifest not found: " << argv[2] << '\n';
+        return 1;
+    }
+
+    Batch batch{ manifest };
+
+    if (argc > 3) {
+        std::ofstream results{ argv[3] };
+        batch.run(results);
+    }
+    else {
+        batch.run(std::cout);
+    }
+
+    return 0;
+}
+
+/// <summary>
+/// Monte Carlo tolerance study: VLM --uq spec.json [stats.jsonl]
+/// </summary>
+int runUq(int argc, char* argv[])
+{
+    std::ifstream spec{ argv[2] };
+    if (spec.fail()) {
+        std::cout << "UQ spec not found: " << argv[2] << '\n';
+        return 1;
+    }
+
+    MonteCarlo mc{ spec };
+
+    if (argc > 3) {
+        std::ofstream results{ argv[3] };
+        mc.run(results);
+    }
+    else {
+        mc.run(std::cout);
+    }
+
+    return 0;
+}
+
+/// <summary>
+/// Surrogate build: VLM --surrogate spec.json surrogate.bin
+/// </summary>
+int runSurrogate(int argc, char* argv[])
+{
+    std::ifstream spec{ argv[2] };
+    if (spec.fail() || argc < 4) {
+        std::cout << "Usage: VLM --surrogate spec.json surrogate.bin" << '\n';
+        return 1;
+    }
+
+    SurrogateBuilder builder{ spec };
+    Surrogate surrogate{ builder.build(std::cout) };
+    surrogate.save(argv[3]);
+
+    return 0;
+}
+
+/// <summary>
+/// Surrogate query: VLM --query surrogate.bin p0 p1 ...
+/// </summary>
+int runQuery(int argc, char* argv[])
+{
+    Surrogate surrogate{ Surrogate::load(argv[2]) };
+
+    std::vector<double> params;
+    for (int i{ 3 }; i < argc; i++) {
+        params.push_back(std::stod(argv[i]));
+    }
+    if (params.size() != surrogate.getParameters().size()) {
+        std::cout << "Expected " << surrogate.getParameters().size()
+            << " parameters." << '\n';
+        return 1;
+    }
+
+    Surrogate::Prediction prediction{ surrogate.predict(params) };
+    std::cout << "CL: " << prediction.CL << " +/- " << prediction.CL_error << '\n';
+    std::cout << "CDi: " << prediction.CDi << " +/- " << prediction.CDi_error << '\n';
+
+    return 0;
+}
+
+/// <summary>
+/// Adaptive mesh refinement: VLM --adapt spec.json [levels.jsonl]
+/// </summary>
+int runAdaptive(int argc, char* argv[])
+{
+    std::ifstream spec{ argv[2] };
+    if (spec.fail()) {
+        std::cout << "Adaptive spec not found: " << argv[2] << '\n';
+        return 1;
+    }
+
+    Adaptive adaptive{ spec };
+
+    if (argc > 3) {
+        std::ofstream results{ argv[3] };
+        adaptive.run(results);
+    }
+    else {
+        adaptive.run(std::cout);
+    }
 
-    //std::string filename;
-    //
-    //std::cout << "plane json: ";
-    //std::cin >> filename;
-    //
-    //std::ifstream f{ filename };
-    std::ifstream f{ "D:\\Documents\\C++ Projects\\1. vlm\\data\\wing.json" };
+    return 0;
+}
+
+/// <summary>
+/// Richardson mesh convergence study: VLM --convergence spec.json [levels.jsonl]
+/// </summary>
+int runConvergence(int argc, char* argv[])
+{
+    std::ifstream spec{ argv[2] };
+    if (spec.fail()) {
+        std::cout << "Convergence spec not found: " << argv[2] << '\n';
+        return 1;
+    }
+
+    ConvergenceStudy study{ spec };
+
+    if (argc > 3) {
+        std::ofstream results{ argv[3] };
+        study.run(results);
+    }
+    else {
+        study.run(std::cout);
+    }
+
+    return 0;
+}
+
+/// <summary>
+/// Aerofoil library index: VLM --library directory
+/// Builds or refreshes the directory's pack and writes one JSON line per
+/// aerofoil.
+/// </summary>
+int runLibrary(int argc, char* argv[])
+{
+    auto start{ std::chrono::high_resolution_clock::now() };
+    std::vector<AerofoilLibrary::Entry> entries{ AerofoilLibrary::shared().addDirectory(argv[2]) };
+    std::chrono::duration<double, std::milli> dt{ std::chrono::high_resolution_clock::now() - start };
+
+    for (const AerofoilLibrary::Entry& entry : entries) {
+        nlohmann::json record;
+        record["file"] = entry.file;
+        record["points"] = entry.rows;
+        record["checksum"] = entry.checksum;
+        std::cout << record.dump() << '\n';
+    }
+    std::cout << entries.size() << " aerofoils indexed in " << dt.count() << " ms" << '\n';
+
+    return 0;
+}
+
+/// <summary>
+/// Unsteady time history: VLM --unsteady spec.json [history.jsonl]
+/// See unsteadyrun.hpp for the spec layout. A restarted run appends to the
+/// history file.
+/// </summary>
+int runUnsteady(int argc, char* argv[])
+{
+    std::ifstream spec{ argv[2] };
+    if (spec.fail()) {
+        std::cout << "Unsteady spec not found: " << argv[2] << '\n';
+        return 1;
+    }
+
+    UnsteadyRun run{ spec };
+
+    if (argc > 3) {
+        std::ofstream history{ argv[3], run.isRestart() ? std::ios::app : std::ios::out };
+        run.run(history);
+    }
+    else {
+        run.run(std::cout);
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 2) {
+        std::string mode{ argv[1] };
+        try {
+            if (mode == "--batch") { return runBatch(argc, argv); }
+            if (mode == "--uq") { return runUq(argc, argv); }
+            if (mode == "--surrogate") { return runSurrogate(argc, argv); }
+            if (mode == "--query") { return runQuery(argc, argv); }
+            if (mode == "--unsteady") { return runUnsteady(argc, argv); }
+            if (mode == "--adapt") { return runAdaptive(argc, argv); }
+            if (mode == "--convergence") { return runConvergence(argc, argv); }
+            if (mode == "--library") { return runLibrary(argc, argv); }
+        }
+        catch (const std::exception& err) {
+            std::cout << err.what() << '\n';
+            return 1;
+        }
+    }
+
+    std::string filename;
+    if (argc > 1) {
+        filename = argv[1];
+    }
+    else {
+        std::cout << "plane json: ";
+        std::cin >> filename;
+    }
+
+    std::ifstream f{ filename };
     if (f.fail()) {
         std::cout << "File not found." << '\n';
         return 0;
     }
 
-    Plane plane{ f };
+    std::unique_ptr<Plane> plane_ptr;
+    try {
+        plane_ptr = std::make_unique<Plane>(f);
+    }
+    catch (const std::exception& err) {
+        std::cout << err.what() << '\n';
+        return 1;
+    }
+    Plane& plane{ *plane_ptr };
+
+    const Plane::Timings& t{ plane.timings };
+    std::cout << "Plane: " << t.total_ms << " ms (parse " << t.parse_ms
+        << ", aerofoils " << t.aerofoils_ms << ", mesh " << t.mesh_ms
+        << ", multimesh " << t.multimesh_ms << ")\n";
 
     /*for (Panel& panel : *plane.mesh) {
         panel.print();
@@ -2,6 +2,7 @@
 
 #include <mesh.hpp>
 #include <panel.hpp>
+#include <utils/mapped_file.hpp>
 
 using rl::Vector3;
 
@@ -9,93 +10,84 @@ void Mesh::generate(Wing* wing)
 {
     calc_points(wing);
     calc_panels(wing);
+
+    points = pointBuffer;
+    panels = panelBuffer;
+}
+
+std::shared_ptr<Mesh> Mesh::fromMapping(
+    std::shared_ptr<utils::MappedFile> mapping,
+    std::size_t pointsOffset, std::size_t nPoints,
+    std::size_t panelsOffset, std::size_t nPanels
+)
+{
+    std::shared_ptr<Mesh> mesh{ std::make_shared<Mesh>() };
+    mesh->points = { reinterpret_cast<const double*>(mapping->data() + pointsOffset), 3 * nPoints };
+    mesh->panels = { reinterpret_cast<Panel*>(mapping->data() + panelsOffset), nPanels };
+
+    for (Panel& panel : mesh->panels) { panel.points = mesh->points.data(); }
+
+    mesh->mapping = std::move(mapping);
+    return mesh;
 }
 
 /// <summary>
-/// Calculates coordinates of mesh points..
+/// Calculates coordinates of mesh points, row by row from the leading edge
+/// ((n+1) x (m_sum+1) points), straight into the flat point buffer.
 /// </summary>
 void Mesh::calc_points(Wing* wing)
 {
-    // Pre-generate camber coordiantes for each section
-    std::vector<nc::NdArray<double>> cambers;
-    for (Section& section : wing->sections)
+    const int n{ wing->n };
+    const int m{ wing->m_sum };
+    const int n_sections{ (int)wing->sections.size() };
+
+    // Camber points of each section, scaled by chord, rotated about the
+    // leading edge by the incident angle and moved to it: (n+1) x 3 per
+    // section. Unit chord camber lines are shared between sections.
+    std::vector<double> chords(3 * (size_t)(n + 1) * n_sections);
+    for (int j{ 0 }; j != n_sections; j++)
     {
-        const nc::NdArray<double>& camber{
-                section.aerofoil.get()->get_camber_points( wing->n, section.chord )
-        };
+        Section& section{ wing->sections[j] };
+        const std::vector<double>& c{ section.aerofoil->get_unit_camber(n, section.chordwise) };
+        const double* le{ section.leading_edge.data() };
 
-        cambers.push_back(camber);
-    }
+        double cos_a{ section.chord * nc::cos(nc::deg2rad(section.incident)) };
+        double sin_a{ -section.chord * nc::sin(nc::deg2rad(section.incident)) };
 
-    int N = (wing->m_sum + 1) * (wing->n + 1);
-    points = nc::zeros<double>(N, 3);
+        for (int i{ 0 }; i <= n; i++)
+        {
+            double* P{ &chords[3 * ((n + 1) * (size_t)j + i)] };
+            P[0] = le[0] + (c[2 * i] * cos_a - c[2 * i + 1] * sin_a);
+            P[1] = le[1] + 0;
+            P[2] = le[2] + (c[2 * i] * sin_a + c[2 * i + 1] * cos_a);
+        }
+    }
 
-    int point_count{ 0 };
+    pointBuffer.resize(3 * (size_t)(n + 1) * (m + 1));
 
     // Loop through chordwise splits
-    for (int i{ 0 }; i <= wing->n; i++) {
-        int s(0);
-
-        // Loop through sections i.e. where chord, leading edge coordinates 
-        // and # spanwise splits change.
-        for (int j{ 1 }; j != wing->sections.size(); j++) {
-
-            Section& section_curr{ wing->sections[j] };
-            Section& section_prev{ wing->sections[j - 1] };
-
-            // Get camber coordinates for each section.
-            const nc::NdArray<double>& camber_curr{ cambers[j] };
-            const nc::NdArray<double>& camber_prev{ cambers[j - 1] };
-
-            // Increment between spanwise splits down chord.
-            auto P1_increment{ camber_prev(i, camber_prev.cSlice()) };
-            auto P2_increment{ camber_curr(i, camber_curr.cSlice()) };
-
-            // Rotation about leading edge for incident angle
-            double cos_prev{ nc::cos(nc::deg2rad(section_prev.incident)) };
-            double sin_prev{ -nc::sin(nc::deg2rad(section_prev.incident)) };
-            double cos_curr{ nc::cos(nc::deg2rad(section_curr.incident)) };
-            double sin_curr{ -nc::sin(nc::deg2rad(section_curr.incident)) };
-
-            // Vectors between spanwise splits down chord.
-            nc::NdArray<double> P1_inc_vec{
-                P1_increment[0] * cos_prev - P1_increment[2] * sin_prev,
-                0,
-                P1_increment[0] * sin_prev + P1_increment[2] * cos_prev
-            };
-
-            nc::NdArray<double> P2_inc_vec{
-                P2_increment[0] * cos_curr - P2_increment[2] * sin_curr,
-                0,
-                P2_increment[0] * sin_curr + P2_increment[2] * cos_curr
-            };
-
-            // Vector between leading edge locations.
-            // Shifts start and end coordiantes of spanwise split down chord.
-            auto P1 = section_prev.leading_edge + P1_inc_vec;
-            auto P2 = section_curr.leading_edge + P2_inc_vec;
-            auto P1P2 = P2 - P1;
-
-            // ... spanwise points.
-            for (int k{ 0 }; k < (section_curr.m + 1); k++) {
-
-                // Skips double generating points at connection between sections.
-                if (k == 0 && s != 0) {
-                    continue;
-                }
-
-                else {
-                    double t = (double)k / section_curr.m;
-                    auto x = P1P2 * t + P1;
-
-                    points(point_count, 0) = x(0, 0);
-                    points(point_count, 1) = x(0, 1);
-                    points(point_count, 2) = x(0, 2);
-
-                    point_count++;
-                }
+    for (int i{ 0 }; i <= n; i++)
+    {
+        double* row{ &pointBuffer[3 * (size_t)(m + 1) * i] };
+
+        // Each pair of sections fills its spanwise splits. Points at the
+        // connection between sections are only generated once.
+        for (int j{ 1 }; j != n_sections; j++)
+        {
+            const int m_j{ wing->sections[j].m };
+            const utils::Spacing& spacing{ wing->sections[j].spanwise };
+            const double* P1{ &chords[3 * ((n + 1) * (size_t)(j - 1) + i)] };
+            const double* P2{ &chords[3 * ((n + 1) * (size_t)j + i)] };
+            const double P1P2[3]{ P2[0] - P1[0], P2[1] - P1[1], P2[2] - P1[2] };
+
+            for (int k{ j == 1 ? 0 : 1 }; k <= m_j; k++)
+            {
+                double t{ spacing(k, m_j) };
+                row[0] = P1P2[0] * t + P1[0];
+                row[1] = P1P2[1] * t + P1[1];
+                row[2] = P1P2[2] * t + P1[2];
+                row += 3;
             }
-            s++;
         }
     }
 }
@@ -110,38 +102,57 @@ void Mesh::calc_points(Wing* wing)
 /// |
 /// x
 /// 
+/// Panels hold corner indices into the point buffer; geometry is then
+/// computed in one pass over the panel buffer (see panelGeometry).
 /// </summary>
-void Mesh::calc_panels(Wing* wing) {
-    int panel_count{ 0 };
+void Mesh::calc_panels(Wing* wing)
+{
+    const int n{ wing->n };
+    const int m{ wing->m_sum };
+    const int N{ n * m };
 
-    for (int i{ 0 }; i < (wing->n); i++)
+    panelBuffer.assign(N, Panel{});
+    for (int i{ 0 }; i < n; i++)
     {
-        for (int j{ 0 }; j < (wing->m_sum); j++)
+        for (int j{ 0 }; j < m; j++)
         {
-            int n{ j + (wing->m_sum + 1) * i};
-
-            auto P1 = points(n, points.cSlice());
-            auto P2 = points(n + 1, points.cSlice());
-            auto P3 = points(n + wing->m_sum + 2, points.cSlice());
-            auto P4 = points(n + wing->m_sum + 1, points.cSlice());
-
-            Panel panel(P1, P2, P3, P4, panel_count);
-
-            panels.push_back(panel);
-
-            panel_count++;
+            int p{ j + (m + 1) * i };
+            Panel& panel{ panelBuffer[j + m * i] };
+            panel.vertices[0] = p;
+            panel.vertices[1] = p + 1;
+            panel.vertices[2] = p + m + 2;
+            panel.vertices[3] = p + m + 1;
+            panel.points = pointBuffer.data();
+            panel.id = j + m * i;
         }
     }
 
+    for (Panel& panel : panelBuffer)
+    {
+        panelGeometry(
+            panel.corner(0), panel.corner(1), panel.corner(2), panel.corner(3),
+            panel.cp, panel.B, panel.C, panel.normal, panel.area, panel.dy
+        );
+    }
 }
 
 MultiMesh::MultiMesh(std::vector<std::shared_ptr<Mesh>> meshes)
     : meshes{ meshes }
-    , nPanels{sumPanels()}
+    , offsets{ calc_offsets(meshes) }
+    , nPanels{ offsets.back() }
 {
 
 }
 
+std::vector<int> MultiMesh::calc_offsets(const std::vector<std::shared_ptr<Mesh>>& meshes)
+{
+    std::vector<int> offsets{ 0 };
+    for (const std::shared_ptr<Mesh>& mesh : meshes) {
+        offsets.push_back(offsets.back() + (int)mesh->getPanels().size());
+    }
+    return offsets;
+}
+
 const std::vector<std::array<Vector3, 2>> MultiMesh::getRlLines()
 {
     const int line_size = nPanels * 4;
@@ -151,7 +162,7 @@ const std::vector<std::array<Vector3, 2>> MultiMesh::getRlLines()
     for (auto it = this->begin(); it !=this->end(); it++)
     {
         const Panel& currentPanel = *it;
-        std::array<nc::NdArray<double>, 4> corners{ currentPanel.getCorners() };
+        std::array<const double*, 4> corners{ currentPanel.getCorners() };
 
         Vector3 P1_rl{ (float)corners[0][0],(float)corners[0][1],(float)corners[0][2] };
         Vector3 P2_rl{ (float)corners[1][0],(float)corners[1][1],(float)corners[1][2] };
@@ -2,6 +2,8 @@
 
 #include <pch.h>
 
+#include <span>
+
 #include <panel.hpp>
 #include <plane.hpp>
 
@@ -10,13 +12,20 @@ using rl::Vector3;
 
 class Wing;
 
+namespace utils { class MappedFile; }
+
 /// <summary>
-/// Mesh object (per wing). Holds vertex and panel data.
+/// Mesh object (per wing). Holds vertex and panel data, either generated
+/// into its own buffers or viewed in a mapped mesh cache file.
 /// </summary>
 class Mesh {
 private:
-    nc::NdArray<double> points;
-    std::vector<Panel> panels;
+    std::vector<double> pointBuffer;    // (n+1)(m_sum+1) x 3, row-major
+    std::vector<Panel> panelBuffer;
+    std::shared_ptr<utils::MappedFile> mapping;     // holds the buffers of a cached mesh
+
+    std::span<const double> points;
+    std::span<Panel> panels;
 
     void calc_points(Wing* wing);
     void calc_panels(Wing* wing);
@@ -24,19 +33,41 @@ private:
 public:
     Mesh() = default;
 
+    // Panels point into this mesh's point buffer.
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
     void generate(Wing* wing);
 
-    nc::NdArray<double> const &getPoints() const { return points; }
+    // Mesh over point and panel buffers in a mapped file (byte offsets,
+    // 8-byte aligned). Panel point pointers are rebased onto the mapping.
+    static std::shared_ptr<Mesh> fromMapping(
+        std::shared_ptr<utils::MappedFile> mapping,
+        std::size_t pointsOffset, std::size_t nPoints,
+        std::size_t panelsOffset, std::size_t nPanels
+    );
+
+    std::span<const double> getPoints() const { return points; }
+    int nPoints() const { return (int)points.size() / 3; }
 
     // getPanels cannot be constant because the panel needs to be updated
     // when vlm is running.
-    std::vector<Panel> &getPanels() { return panels; }
+    std::span<Panel> getPanels() { return panels; }
 
 };
 
+/// <summary>
+/// Panels of all wing meshes under one flat index: wing w owns global
+/// indices [offset(w), offset(w + 1)), in the order of its mesh. Random
+/// access looks up the wing in the offset table, so parallel loops can
+/// split panels by index range.
+/// </summary>
 class MultiMesh {
 private:
     std::vector<std::shared_ptr<Mesh>> meshes;
+    std::vector<int> offsets;   // first global index per mesh, plus total
+
+    static std::vector<int> calc_offsets(const std::vector<std::shared_ptr<Mesh>>& meshes);
 
 public:
     const int nPanels;
@@ -49,111 +80,86 @@ public:
         return meshes[index].get();
     }
 
+    int size() const { return (int)meshes.size(); }
+    int offset(int mesh) const { return offsets[mesh]; }
+
+    // Mesh holding global panel index i.
+    int meshOf(int i) const {
+        return (int)(std::upper_bound(offsets.begin() + 1, offsets.end(), i) - offsets.begin()) - 1;
+    }
+
+    Panel& operator[](int i) {
+        int w{ meshOf(i) };
+        return meshes[w]->getPanels()[i - offsets[w]];
+    }
+
+    // Contiguous panels of one mesh.
+    std::span<Panel> panels(int mesh) {
+        return { meshes[mesh]->getPanels().data(), meshes[mesh]->getPanels().size() };
+    }
+
     /// <summary>
-    /// Iterates over each panel for each mesh in meshes.
+    /// Iterates over each panel for each mesh in meshes, by global index.
+    /// Holds a pointer to the container, so it is cheap to copy.
     /// </summary>
     class PanelIterator
     {
     private:
-        std::vector<std::shared_ptr<Mesh>> meshes;
-        // Using indices because mesh iterators would go out of scope when
-        // temp objects are created and copied by the range-based for loop.
-        size_t currentMeshIndex, endMeshIndex;
-        std::vector<Panel>::iterator currentPanel, endPanel;
+        MultiMesh* multiMesh;
+        int index;          // global panel index
+        int mesh;           // mesh holding index
+        Panel* current;
+
+        void seek() {
+            while (mesh + 1 < multiMesh->size() && index >= multiMesh->offsets[mesh + 1]) { mesh++; }
+            current = index < multiMesh->nPanels
+                ? multiMesh->meshes[mesh]->getPanels().data() + (index - multiMesh->offsets[mesh])
+                : nullptr;
+        }
 
     public:
-        // Constructor. Assigns current and end panels and meshes.
-        PanelIterator(std::vector<std::shared_ptr<Mesh>> meshes)
-            : meshes{ meshes }
-            , currentMeshIndex{ 0 }
-            , endMeshIndex{ meshes.size()}  // One past the end of the array
+        PanelIterator(MultiMesh* multiMesh, int index)
+            : multiMesh{ multiMesh }
+            , index{ index }
+            , mesh{ 0 }
         {
-            currentPanel = meshes[0]->getPanels().begin();
-            endPanel = meshes[0]->getPanels().end();    // One past the end of the array
+            seek();
         }
 
-        // ++ overload. Increments over each mesh then each panel.
         PanelIterator& operator++()
         {
-            // If all panels in the current mesh have been iterated through,
-            // increment the mesh.
-            currentPanel++;
-            if (currentPanel == endPanel)
-            {
-                currentMeshIndex++;
-                // Redefine panels using next mesh.
-                if (currentMeshIndex != endMeshIndex) {
-                    currentPanel = meshes[currentMeshIndex]->getPanels().begin();
-                    endPanel = meshes[currentMeshIndex]->getPanels().end();
-                }
-            }
-
+            index++;
+            current++;
+            // Crossed into the next mesh.
+            if (index == multiMesh->offsets[mesh + 1]) { seek(); }
             return *this;
         }
 
-        // ++ overload but different? Used for traditional for loops.
         PanelIterator operator++(int)
         {
-            // If all panels in the current mesh have been iterated through,
-            // increment the mesh.
-            currentPanel++;
-            if (currentPanel == endPanel)
-            {
-                currentMeshIndex++;
-                // Redefine panels using next mesh.
-                if (currentMeshIndex != endMeshIndex) {
-                    currentPanel = meshes[currentMeshIndex]->getPanels().begin();
-                    endPanel = meshes[currentMeshIndex]->getPanels().end();
-                }
-            }
-
-            return *this;
+            PanelIterator previous{ *this };
+            ++(*this);
+            return previous;
         }
 
-        // * overload. Returns a pointer to the current panel in the iterator.
-        Panel& operator*() {
-            return *currentPanel;
-        }
-
-        // != overload. For use in for loops.
-        bool operator!=(const PanelIterator& other) {
-            return !(*this == other);
-        }
+        Panel& operator*() const { return *current; }
+        Panel* operator->() const { return current; }
 
-        // == overload. Also for use in for loops.
-        bool operator==(const PanelIterator& other) {
-            return currentMeshIndex == other.currentMeshIndex &&
-                currentPanel == other.currentPanel;
-        }
+        // Global index of the current panel.
+        int getIndex() const { return index; }
 
-        // Set the current mesh and panel to their respective iterator ends.
-        // Used for end() function for range-based for loops.
-        void setEnd() {
-            currentMeshIndex = endMeshIndex;
-            currentPanel = meshes[currentMeshIndex - 1]->getPanels().end();
-        }
+        bool operator==(const PanelIterator& other) const { return index == other.index; }
+        bool operator!=(const PanelIterator& other) const { return index != other.index; }
     };
 
     PanelIterator begin() {
-        return PanelIterator(meshes);
+        return PanelIterator(this, 0);
     }
 
     PanelIterator end() {
-        PanelIterator iter{ meshes };
-        iter.setEnd();
-
-        return iter;
+        return PanelIterator(this, nPanels);
     }
 
     const std::vector<std::array<rl::Vector3, 2>> getRlLines();
 
-    const int sumPanels() {
-        int total{ 0 };
-        for (auto it = this->begin(); it != this->end(); it++) {
-            total++;
-        }
-
-        return total;
-    }
-
 };
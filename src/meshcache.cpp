@@ -0,0 +1,197 @@
+#include <pch.h>
+
+#include <cstring>
+#include <iomanip>
+
+#include <meshcache.hpp>
+#include <mesh.hpp>
+#include <utils/hash.hpp>
+#include <utils/mapped_file.hpp>
+
+namespace
+{
+    constexpr char magic[8]{ 'V', 'L', 'M', 'M', 'E', 'S', 'H', '\1' };
+    constexpr std::size_t alignment{ 64 };
+
+    std::size_t aligned(std::size_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+MeshCache::MeshCache(const std::string& directory)
+    : directory{ directory }
+{
+    std::error_code err;
+    std::filesystem::create_directories(this->directory, err);
+}
+
+std::filesystem::path MeshCache::path(std::uint64_t key) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".mesh";
+    return directory / name.str();
+}
+
+std::uint64_t MeshCache::key(const std::string& planeText, const std::vector<std::string>& aerofoilFiles)
+{
+    std::uint64_t hash{ utils::fnv1a(&version, sizeof(version)) };
+
+    const std::uint64_t panelSize{ sizeof(Panel) };
+    hash = utils::fnv1a(&panelSize, sizeof(panelSize), hash);
+    hash = utils::fnv1a(planeText.data(), planeText.size(), hash);
+
+    for (const std::string& file : aerofoilFiles) {
+        hash = utils::fnv1a(file.data(), file.size() + 1, hash);
+
+        std::ifstream f{ file, std::ios::binary };
+        if (f.fail()) {
+            const char missing{ 0 };
+            hash = utils::fnv1a(&missing, 1, hash);
+            continue;
+        }
+
+        std::string bytes{ std::istreambuf_iterator<char>{ f }, std::istreambuf_iterator<char>{} };
+        hash = utils::fnv1a(bytes.data(), bytes.size(), hash);
+    }
+
+    return hash;
+}
+
+/// <summary>
+/// Maps a cache entry and checks it against the plane before handing out
+/// meshes that view it. Any mismatch or read error is a miss.
+/// </summary>
+std::vector<std::shared_ptr<Mesh>> MeshCache::load(
+    std::uint64_t key, const std::vector<std::array<int, 2>>& shapes
+) const
+{
+    const std::filesystem::path file{ path(key) };
+
+    std::error_code err;
+    if (!std::filesystem::exists(file, err)) { return {}; }
+
+    std::shared_ptr<utils::MappedFile> mapping;
+    try {
+        mapping = std::make_shared<utils::MappedFile>(file.string());
+    }
+    catch (const std::runtime_error&) {
+        return {};
+    }
+
+    const std::size_t size{ mapping->size() };
+    const std::size_t nMeshes{ shapes.size() };
+    if (size < sizeof(Header) + nMeshes * sizeof(Entry)) { return {}; }
+
+    Header header;
+    std::memcpy(&header, mapping->data(), sizeof(Header));
+    if (
+        std::memcmp(header.magic, magic, sizeof(magic)) != 0
+        || header.key != key
+        || header.version != version
+        || header.panelSize != sizeof(Panel)
+        || header.nMeshes != nMeshes
+        )
+    {
+        return {};
+    }
+
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    for (std::size_t w{ 0 }; w != nMeshes; w++)
+    {
+        Entry entry;
+        std::memcpy(&entry, mapping->data() + sizeof(Header) + w * sizeof(Entry), sizeof(Entry));
+
+        const std::uint64_t n{ (std::uint64_t)shapes[w][0] };
+        const std::uint64_t m{ (std::uint64_t)shapes[w][1] };
+        if (
+            entry.nPoints != (n + 1) * (m + 1)
+            || entry.nPanels != n * m
+            || entry.pointsOffset % alignment != 0
+            || entry.panelsOffset % alignment != 0
+            || entry.pointsOffset + 3 * sizeof(double) * entry.nPoints > size
+            || entry.panelsOffset + sizeof(Panel) * entry.nPanels > size
+            )
+        {
+            return {};
+        }
+
+        // Corner indices must address the entry's own points.
+        const Panel* panels{ reinterpret_cast<const Panel*>(mapping->data() + entry.panelsOffset) };
+        for (std::uint64_t k{ 0 }; k != entry.nPanels; k++) {
+            for (int vertex : panels[k].vertices) {
+                if (vertex < 0 || (std::uint64_t)vertex >= entry.nPoints) { return {}; }
+            }
+        }
+
+        meshes.push_back(Mesh::fromMapping(
+            mapping, entry.pointsOffset, entry.nPoints, entry.panelsOffset, entry.nPanels
+        ));
+    }
+
+    return meshes;
+}
+
+bool MeshCache::store(std::uint64_t key, const std::vector<std::shared_ptr<Mesh>>& meshes) const
+{
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.key = key;
+    header.version = version;
+    header.panelSize = sizeof(Panel);
+    header.nMeshes = (std::uint32_t)meshes.size();
+
+    // Buffers follow the header and entry table, each aligned.
+    std::vector<Entry> entries(meshes.size());
+    std::size_t offset{ sizeof(Header) + meshes.size() * sizeof(Entry) };
+    for (std::size_t w{ 0 }; w != meshes.size(); w++)
+    {
+        Entry& entry{ entries[w] };
+        entry.nPoints = meshes[w]->getPoints().size() / 3;
+        entry.nPanels = meshes[w]->getPanels().size();
+
+        entry.pointsOffset = aligned(offset);
+        offset = entry.pointsOffset + 3 * sizeof(double) * entry.nPoints;
+        entry.panelsOffset = aligned(offset);
+        offset = entry.panelsOffset + sizeof(Panel) * entry.nPanels;
+    }
+
+    std::vector<char> buffer(offset, 0);
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+    std::memcpy(buffer.data() + sizeof(Header), entries.data(), entries.size() * sizeof(Entry));
+    for (std::size_t w{ 0 }; w != meshes.size(); w++)
+    {
+        std::span<const double> points{ meshes[w]->getPoints() };
+        std::span<Panel> panels{ meshes[w]->getPanels() };
+        std::memcpy(buffer.data() + entries[w].pointsOffset, points.data(), points.size_bytes());
+        std::memcpy(buffer.data() + entries[w].panelsOffset, panels.data(), panels.size_bytes());
+    }
+
+    // Unique temporary name per writer.
+    static std::atomic<std::uint64_t> counter{ 0 };
+    std::uint64_t unique{ std::random_device{}() ^ (counter++ << 32) };
+
+    const std::filesystem::path file{ path(key) };
+    std::filesystem::path tmp{ file };
+    tmp += "." + std::to_string(unique) + ".tmp";
+
+    {
+        std::ofstream f{ tmp, std::ios::binary };
+        f.write(buffer.data(), (std::streamsize)buffer.size());
+        if (!f) {
+            f.close();
+            std::error_code err;
+            std::filesystem::remove(tmp, err);
+            return false;
+        }
+    }
+
+    std::error_code err;
+    std::filesystem::rename(tmp, file, err);
+    if (err) {
+        std::filesystem::remove(tmp, err);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <pch.h>
+
+#include <filesystem>
+
+class Mesh;
+
+/// <summary>
+/// On-disk cache of generated wing meshes, so repeated runs of the same
+/// plane skip mesh generation. Entries are keyed by a hash of the plane
+/// .json text and the bytes of every aerofoil file it references: editing
+/// either gives a new key, so stale entries are never read. Each entry is a
+/// compact binary file (<key>.mesh) holding the point and panel buffers of
+/// every wing, which are mapped and used in place.
+///
+/// File layout (native byte order, buffers 64-byte aligned):
+///     Header
+///     Entry[nMeshes]      byte offsets and counts of each wing's buffers
+///     point and panel buffers
+/// A file whose header or counts do not match the plane is treated as a
+/// miss and overwritten by the next store.
+/// </summary>
+class MeshCache {
+public:
+    // Bump when Panel or the file layout changes.
+    static constexpr std::uint32_t version{ 1 };
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint64_t key;
+        std::uint32_t version;
+        std::uint32_t panelSize;
+        std::uint32_t nMeshes;
+        std::uint32_t reserved;
+    };
+
+    struct Entry {
+        std::uint64_t pointsOffset;
+        std::uint64_t nPoints;
+        std::uint64_t panelsOffset;
+        std::uint64_t nPanels;
+    };
+
+    std::filesystem::path directory;
+
+    std::filesystem::path path(std::uint64_t key) const;
+
+public:
+    MeshCache(const std::string& directory);
+
+    // Key of a plane from its .json text and aerofoil files (missing files
+    // hash as missing, matching the flat plate fallback).
+    static std::uint64_t key(const std::string& planeText, const std::vector<std::string>& aerofoilFiles);
+
+    // Meshes of a cached plane, or empty on a miss. shapes holds the
+    // expected {n, m_sum} of every wing.
+    std::vector<std::shared_ptr<Mesh>> load(
+        std::uint64_t key, const std::vector<std::array<int, 2>>& shapes
+    ) const;
+
+    // Writes a plane's meshes. The file is written under a temporary name
+    // and renamed, so concurrent runs never see a partial entry. Returns
+    // false if the cache could not be written.
+    bool store(std::uint64_t key, const std::vector<std::shared_ptr<Mesh>>& meshes) const;
+
+};
@@ -0,0 +1,75 @@
+#include <pch.h>
+
+#include <onset.hpp>
+
+Vlm::OnsetFunction Onset::gust(
+    const Vlm& vlm, double amplitude, double length, double dt, double x0
+)
+{
+    nc::NdArray<double> points{ vlm.collocationPoints() };
+    nc::NdArray<double> freestream{ vlm.freestreamOnset() };
+    double Qinf{ vlm.getQinf() };
+
+    return [=](int step, nc::NdArray<double>& onset) {
+        onset = freestream;
+
+        double t{ step * dt };
+        for (int i{ 0 }; i != (int)points.shape().rows; i++)
+        {
+            // Distance the gust front has travelled past this point.
+            double s{ Qinf * t - (points(i, 0) - x0) };
+            if (s > 0 && s < length) {
+                onset(i, 2) += 0.5 * amplitude * (1 - std::cos(2 * nc::constants::pi * s / length));
+            }
+        }
+    };
+}
+
+Vlm::OnsetFunction Onset::heave(
+    const Vlm& vlm, double amplitude, double frequency, double dt
+)
+{
+    nc::NdArray<double> freestream{ vlm.freestreamOnset() };
+    double omega{ 2 * nc::constants::pi * frequency };
+
+    return [=](int step, nc::NdArray<double>& onset) {
+        onset = freestream;
+
+        // Body moving up is seen as a downward onset velocity.
+        double h_dot{ amplitude * omega * std::cos(omega * step * dt) };
+        for (int i{ 0 }; i != (int)onset.shape().rows; i++) {
+            onset(i, 2) -= h_dot;
+        }
+    };
+}
+
+Vlm::OnsetFunction Onset::pitch(
+    const Vlm& vlm, double amplitude, double frequency, double dt,
+    std::array<double, 3> pivot
+)
+{
+    nc::NdArray<double> points{ vlm.collocationPoints() };
+    nc::NdArray<double> V{ vlm.getFreestream() };
+    double omega{ 2 * nc::constants::pi * frequency };
+    double amplitude_rad{ nc::deg2rad(amplitude) };
+
+    return [=](int step, nc::NdArray<double>& onset) {
+        double t{ step * dt };
+        double theta{ amplitude_rad * std::sin(omega * t) };
+        double q{ amplitude_rad * omega * std::cos(omega * t) };
+
+        // Freestream seen by the pitched body (alpha + theta).
+        double Vx{ V[0] * std::cos(theta) - V[2] * std::sin(theta) };
+        double Vz{ V[0] * std::sin(theta) + V[2] * std::cos(theta) };
+
+        const int N{ (int)points.shape().rows };
+        if (onset.shape().rows != N) { onset = nc::zeros<double>(N, 3); }
+
+        // Plus the relative velocity of the rotating body: -(Omega x r).
+        for (int i{ 0 }; i != N; i++) {
+            onset(i, 0) = Vx - q * (points(i, 2) - pivot[2]);
+            onset(i, 1) = V[1];
+            onset(i, 2) = Vz + q * (points(i, 0) - pivot[0]);
+        }
+    };
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <pch.h>
+
+#include <vlm.hpp>
+
+/// <summary>
+/// Onset velocity time series for Vlm::runOnset. Each builder captures the
+/// collocation points and freestream of a solved Vlm and returns a function
+/// filling the N x 3 onset field of a time step (t = step * dt).
+///
+/// Axes as the mesh: x downstream, y spanwise, z up.
+/// </summary>
+class Onset {
+public:
+    // Vertical 1-cosine gust of peak velocity amplitude and length (gust
+    // wavelength), convected with the freestream. The gust front is at x0 at
+    // t = 0.
+    static Vlm::OnsetFunction gust(
+        const Vlm& vlm, double amplitude, double length, double dt, double x0 = 0
+    );
+
+    // Sinusoidal heave h = amplitude * sin(2 pi f t).
+    static Vlm::OnsetFunction heave(
+        const Vlm& vlm, double amplitude, double frequency, double dt
+    );
+
+    // Sinusoidal pitch theta = amplitude * sin(2 pi f t) (deg, nose up) about
+    // pivot.
+    static Vlm::OnsetFunction pitch(
+        const Vlm& vlm, double amplitude, double frequency, double dt,
+        std::array<double, 3> pivot = { 0, 0, 0 }
+    );
+
+};
@@ -2,45 +2,95 @@
 
 #include <pch.h>
 
-class Panel {
-private:
-    nc::NdArray<double> P1;
-    nc::NdArray<double> P2;
-    nc::NdArray<double> P3;
-    nc::NdArray<double> P4;
+/// <summary>
+/// Derived panel geometry from its corners (see Mesh::calc_panels for the
+/// corner order):
+///     cp      collocation point, 3/4 chord (Katz & Plotkin)
+///     B, C    bound vortex ends, 1/4 chord
+///     normal  unit normal at cp
+///     area    assumes a convex quadrilateral of 2 equally sized triangles
+///     dy      span (P1-P2)
+/// The chordwise offsets of both sides are taken along P1-P4.
+/// </summary>
+inline void panelGeometry(
+    const double* P1, const double* P2, const double* P3, const double* P4,
+    double* cp, double* B, double* C, double* normal, double& area, double& dy
+)
+{
+    double side[3];
+    for (int d{ 0 }; d != 3; d++) { side[d] = P4[d] - P1[d]; }
+
+    for (int d{ 0 }; d != 3; d++)
+    {
+        double _P1{ P1[d] + 0.75 * side[d] };
+        double _P2{ P2[d] + 0.75 * side[d] };
+        cp[d] = 0.5 * (_P2 - _P1) + _P1;
+
+        B[d] = P1[d] + 0.25 * side[d];
+        C[d] = P2[d] + 0.25 * side[d];
+    }
+
+    // n = (cp - P2) x (cp - P1), normalised.
+    double a[3]{ cp[0] - P2[0], cp[1] - P2[1], cp[2] - P2[2] };
+    double b[3]{ cp[0] - P1[0], cp[1] - P1[1], cp[2] - P1[2] };
+    double n[3]{ a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+    double n_norm{ std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) };
+    for (int d{ 0 }; d != 3; d++) { normal[d] = n[d] / n_norm; }
 
-    int id;
+    // area = |P12 x P23 + P34 x P41| / 2
+    double P12[3], P23[3], P34[3], P41[3];
+    for (int d{ 0 }; d != 3; d++)
+    {
+        P12[d] = P2[d] - P1[d];
+        P23[d] = P3[d] - P2[d];
+        P34[d] = P4[d] - P3[d];
+        P41[d] = P1[d] - P4[d];
+    }
+    double s[3]{
+        (P12[1] * P23[2] - P12[2] * P23[1]) + (P34[1] * P41[2] - P34[2] * P41[1]),
+        (P12[2] * P23[0] - P12[0] * P23[2]) + (P34[2] * P41[0] - P34[0] * P41[2]),
+        (P12[0] * P23[1] - P12[1] * P23[0]) + (P34[0] * P41[1] - P34[1] * P41[0])
+    };
+    area = 0.5 * std::sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
 
+    dy = std::sqrt(
+        (P1[0] - P2[0]) * (P1[0] - P2[0]) + (P1[1] - P2[1]) * (P1[1] - P2[1])
+        + (P1[2] - P2[2]) * (P1[2] - P2[2]));
+}
+
+/// <summary>
+/// Plain panel record: corner indices into the owning mesh's point buffer
+/// plus derived geometry and results as fixed size fields, so panels are
+/// trivially copyable and contiguous in Mesh::panels.
+/// </summary>
+class Panel {
 public:
-    double area;
-    nc::NdArray<double> cp;
-    nc::NdArray<double> B;
-    nc::NdArray<double> C;
-    nc::NdArray<double> normal;
+    int vertices[4]{};          // P1..P4 point indices
+    const double* points{ nullptr };    // owning mesh point buffer
+    int id{ 0 };
+
+    double area{ 0 };
+    double cp[3]{};
+    double B[3]{};
+    double C[3]{};
+    double normal[3]{};
 
-    double dy;      // span
+    double dy{ 0 };      // span
     double vorticity{ 0 };   // induced vorticity
     double dL{ 0 };      // induced lift
     double w_ind{ 0 };   // induced velocity
     double dDi{ 0 };      // induced drag
 
-    Panel(
-        nc::NdArray<double> P1,
-        nc::NdArray<double> P2,
-        nc::NdArray<double> P3,
-        nc::NdArray<double> P4,
-        int id
-    );
-
-    void calc_area();
-    void calc_cp();
-    void calc_bound_vortex();
-    void calc_normal();
-
-    const std::array<nc::NdArray<double>, 4> getCorners() const {
-        return { P1, P2, P3, P4 };
+    // Corner k (0..3 = P1..P4) in the mesh point buffer.
+    const double* corner(int k) const { return points + 3 * vertices[k]; }
+
+    // View of the four corners (no copies).
+    std::array<const double*, 4> getCorners() const {
+        return { corner(0), corner(1), corner(2), corner(3) };
     }
 
-    void print();
+    void print() const;
+
+};
 
-};
\ No newline at end of file
+static_assert(std::is_trivially_copyable_v<Panel>);
@@ -9,6 +9,16 @@
 #include <cmath>
 #include <algorithm>
 #include <chrono>
+#include <limits>
+#include <sstream>
+#include <random>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #include <NumCpp/NdArray.hpp>
 #include <NumCpp/Functions/zeros.hpp>
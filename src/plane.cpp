@@ -2,20 +2,118 @@
 
 #include <plane.hpp>
 #include <mesh.hpp>
+#include <meshcache.hpp>
+#include <aerofoillibrary.hpp>
+#include <utils/parallel.hpp>
 
 using json = nlohmann::json;
 
-Plane::Plane(std::ifstream& f) {
+namespace
+{
+    double elapsed_ms(std::chrono::high_resolution_clock::time_point start)
+    {
+        std::chrono::duration<double, std::milli> dt{ std::chrono::high_resolution_clock::now() - start };
+        return dt.count();
+    }
+
+    /// <summary>
+    /// parallelFor that rethrows the first exception thrown by a task on the
+    /// calling thread (an exception escaping a worker thread would end the
+    /// program).
+    /// </summary>
+    template<typename Task>
+    void runTasks(int n, Task&& task, int nThreads)
+    {
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        utils::parallelFor(n, [&](int first, int last)
+        {
+            for (int i{ first }; i != last; i++)
+            {
+                try {
+                    task(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock{ error_mutex };
+                    if (!error) { error = std::current_exception(); }
+                }
+            }
+        }, nThreads, 1);
+
+        if (error) { std::rethrow_exception(error); }
+    }
+
+    /// <summary>
+    /// Panel spacing: a name ("cosine"), an object with a clustering
+    /// parameter ({ "type": "tanh", "clustering": 3 }) or a list of custom
+    /// node positions from 0 to 1.
+    /// </summary>
+    utils::Spacing read_spacing(const json& j)
+    {
+        utils::Spacing spacing;
+        if (j.is_array()) {
+            spacing.type = utils::Spacing::Type::custom;
+            spacing.points = j.get<std::vector<double>>();
+            return spacing;
+        }
+
+        std::string type{ j.is_object() ? j.at("type").get<std::string>() : j.get<std::string>() };
+        if (j.is_object()) { spacing.clustering = j.value("clustering", spacing.clustering); }
+
+        if (type == "uniform") { spacing.type = utils::Spacing::Type::uniform; }
+        else if (type == "cosine") { spacing.type = utils::Spacing::Type::cosine; }
+        else if (type == "half_cosine") { spacing.type = utils::Spacing::Type::half_cosine; }
+        else if (type == "half_cosine_start") { spacing.type = utils::Spacing::Type::half_cosine_start; }
+        else if (type == "tanh") { spacing.type = utils::Spacing::Type::tanh; }
+        else {
+            throw std::invalid_argument("Unknown panel spacing: " + type);
+        }
+        return spacing;
+    }
+}
+
+Plane::Plane(std::ifstream& f, int nThreads, const std::string& cacheDir)
+    : nThreads{ nThreads }
+    , cacheDir{ cacheDir }
+{
+    auto start{ std::chrono::high_resolution_clock::now() };
 
     read_json(f);
+    build();
+
+    timings.total_ms = elapsed_ms(start);
+}
+
+Plane::Plane(std::vector<std::unique_ptr<Wing>> wings, int nThreads)
+    : nThreads{ nThreads }
+    , wings{ std::move(wings) }
+    , n_wings{ (int)this->wings.size() }
+{
+    auto start{ std::chrono::high_resolution_clock::now() };
+
+    build();
+
+    timings.total_ms = elapsed_ms(start);
+}
+
+/// <summary>
+/// Reference dimensions, wing meshes and the plane mesh container.
+/// </summary>
+void Plane::build()
+{
     calc_ref();
 
-    // generate wing meshes.
-    for (auto& wing : wings) {
-        wing->generateMesh();
+    // generate wing meshes - wings are independent. Cached meshes were
+    // set by read_json.
+    auto start{ std::chrono::high_resolution_clock::now() };
+    if (!meshCached) {
+        runTasks(n_wings, [&](int w) { wings[w]->generateMesh(); }, nThreads);
     }
+    timings.mesh_ms = elapsed_ms(start);
 
     // populate wing mesh container.
+    start = std::chrono::high_resolution_clock::now();
     std::vector<std::shared_ptr<Mesh>> wing_meshes;
     for (auto& wing : wings) {
         std::shared_ptr<Mesh> mesh = wing->getMesh();
@@ -23,7 +121,25 @@ Plane::Plane(std::ifstream& f) {
     }
 
     // plane mesh container.
-    mesh = new MultiMesh { wing_meshes };
+    mesh = std::make_unique<MultiMesh>(wing_meshes);
+    timings.multimesh_ms = elapsed_ms(start);
+
+    // A failed store only costs the next run its cache hit.
+    if (!cacheDir.empty() && !meshCached) {
+        start = std::chrono::high_resolution_clock::now();
+        MeshCache{ cacheDir }.store(cacheKey, wing_meshes);
+        timings.cache_ms += elapsed_ms(start);
+    }
+}
+
+std::vector<std::unique_ptr<Wing>> Plane::copyWings() const
+{
+    std::vector<std::unique_ptr<Wing>> copy;
+    for (auto& wing : wings) {
+        copy.push_back(std::make_unique<Wing>(*wing));
+    }
+
+    return copy;
 }
 
 void Wing::generateMesh()
@@ -43,70 +159,177 @@ void Section::print() {
     std::cout << "chords: " << chord << std::endl;
     std::cout << "angles of incident: [" << incident << '\n';
     std::cout << "aerofoil file: " << aerofoil.get()->get_filepath() << '\n';
+    if (polar) { std::cout << "polar file: " << polar->get_filepath() << '\n'; }
 
 }
 
 /// <summary>
-/// Reads json file defining plane.
+/// Reads json file defining plane. Sections are parsed first; each distinct
+/// aerofoil/polar file is then loaded once, concurrently, and shared by the
+/// sections that use it. Aerofoils come from the process-wide
+/// AerofoilLibrary, so planes share them too; an optional top level
+/// "aerofoil_library" (directory or list of directories) adds libraries
+/// first. With a mesh cache, the cached meshes are looked up before loading
+/// and aerofoil reads are deferred on a hit.
 /// </summary>
 /// 
 /// <param name="file"> {std::ifstream}: Input .json filesream.</param>
 void Plane::read_json(std::ifstream& file) {
 
-    json j_wings = json::parse(file)["wings"];
+    auto start{ std::chrono::high_resolution_clock::now() };
+
+    std::string text{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
     file.close();
 
-    std::vector<std::shared_ptr<Aerofoil>> aerofoils;
+    json j_plane = json::parse(text);
+    json j_wings = j_plane["wings"];
 
-    for (auto& j_wing : j_wings) {
-        Wing wing(j_wing["#chordwise_panels"]);
+    AerofoilLibrary& library{ AerofoilLibrary::shared() };
+    if (j_plane.contains("aerofoil_library")) {
+        json j_library = j_plane["aerofoil_library"];
+        if (j_library.is_string()) { library.addDirectory(j_library.get<std::string>(), nThreads); }
+        else {
+            for (auto& directory : j_library) { library.addDirectory(directory.get<std::string>(), nThreads); }
+        }
+    }
+
+    struct SectionInput {
+        int m;
+        std::array<double, 3> leading_edge;
+        double chord;
+        double incident;
+        int aerofoil;       // index into aerofoil_files
+        int polar{ -1 };    // index into polar_files
+        utils::Spacing spanwise;
+        utils::Spacing chordwise;
+    };
+    struct WingInput {
+        int n;
+        std::vector<SectionInput> sections;
+    };
+
+    std::vector<WingInput> inputs;
+    std::vector<std::string> aerofoil_files;
+    std::vector<std::string> polar_files;
+
+    // Index of a file in the list, added if new.
+    auto file_index = [](std::vector<std::string>& files, const std::string& file) {
+        auto it{ std::find(files.begin(), files.end(), file) };
+        if (it != files.end()) { return (int)(it - files.begin()); }
+        files.push_back(file);
+        return (int)files.size() - 1;
+    };
 
-        json j_sections = j_wing["sections"];
+    for (auto& j_wing : j_wings) {
+        WingInput wing;
+        wing.n = j_wing["#chordwise_panels"];
 
-        for (int i{ 0 }; i != j_sections.size(); i++) {
-            auto& j_section = j_sections[i];
+        for (auto& j_section : j_wing["sections"]) {
+            SectionInput section;
 
             // read chords from json
-            double chord{ j_section["chord"] };
+            section.chord = j_section["chord"];
 
             // read leading edge coordinates from json
-            std::array<double, 3> le = j_section["leading_edge"];
-            nc::NdArray<double> leading_edge{ le };
+            section.leading_edge = j_section["leading_edge"].get<std::array<double, 3>>();
 
             // read number of spanwise splits from json
-            int m(j_section["#spanwise_panels"]);
+            section.m = j_section["#spanwise_panels"];
 
             // read angles of incident from json
-            double incident = j_section["i_angle"];
-
-            // read aerofoil .dat path from json
-            std::string aerofoil_file = j_section["aerofoil"];
-
-            // Generate aerofoil if it doesn't already exist.
-            int a_index{ -1 };
-            std::shared_ptr<Aerofoil> aerofoil;
+            section.incident = j_section["i_angle"];
+
+            // read aerofoil .dat path or analytic camber line from json
+            // (CST objects are kept as their dump, see AnalyticCamber)
+            const json& j_aerofoil = j_section["aerofoil"];
+            section.aerofoil = file_index(
+                aerofoil_files, j_aerofoil.is_string() ? j_aerofoil.get<std::string>() : j_aerofoil.dump()
+            );
+
+            // read optional 2D polar path from json
+            if (j_section.contains("polar")) {
+                section.polar = file_index(polar_files, j_section["polar"].get<std::string>());
+            }
 
-            for (auto& a : aerofoils) {
-                if (a.get()->get_filepath() == aerofoil_file)
-                {
-                    aerofoil = a;
-                    a_index = 1;
-                    break;
+            // read optional panel spacing from json
+            if (j_section.contains("spanwise_spacing")) {
+                // Spaces the panels from the previous section, so the first
+                // section has none.
+                if (wing.sections.empty()) {
+                    throw std::invalid_argument("spanwise_spacing is not allowed on the first section of a wing.");
                 }
+                section.spanwise = read_spacing(j_section["spanwise_spacing"]);
+                section.spanwise.check(section.m);
             }
-
-            if (a_index == -1) {
-                aerofoil = std::make_shared<Aerofoil>(aerofoil_file);
-                aerofoils.push_back(aerofoil);
+            if (j_section.contains("chordwise_spacing")) {
+                section.chordwise = read_spacing(j_section["chordwise_spacing"]);
+                section.chordwise.check(wing.n);
             }
 
+            wing.sections.push_back(section);
+        }
+
+        inputs.push_back(wing);
+    }
+    timings.parse_ms = elapsed_ms(start);
+
+    // Resolve aerofoils (unloaded).
+    const int n_aerofoils{ (int)aerofoil_files.size() };
+    std::vector<std::shared_ptr<Aerofoil>> aerofoils(n_aerofoils);
+    std::vector<std::string> aerofoil_paths(n_aerofoils);
+    for (int k{ 0 }; k != n_aerofoils; k++) {
+        aerofoils[k] = library.get(aerofoil_files[k]);
+        aerofoil_paths[k] = aerofoils[k]->get_filepath();
+    }
+
+    // Look up cached meshes.
+    std::vector<std::shared_ptr<Mesh>> cached;
+    if (!cacheDir.empty()) {
+        start = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::array<int, 2>> shapes;
+        for (const WingInput& input : inputs) {
+            int m_sum{ 0 };
+            for (int i{ 1 }; i < (int)input.sections.size(); i++) { m_sum += input.sections[i].m; }
+            shapes.push_back({ input.n, m_sum });
+        }
+
+        cacheKey = MeshCache::key(text, aerofoil_paths);
+        cached = MeshCache{ cacheDir }.load(cacheKey, shapes);
+        meshCached = !cached.empty();
+
+        timings.cache_ms = elapsed_ms(start);
+    }
+
+    // Load aerofoils (a no-op for those already loaded by another plane)
+    // and polars.
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<std::shared_ptr<Polar>> polars(polar_files.size());
+
+    runTasks(n_aerofoils + (int)polar_files.size(), [&](int k) {
+        if (k < n_aerofoils) {
+            if (!meshCached) { aerofoils[k]->load(); }
+        }
+        else { polars[k - n_aerofoils] = std::make_shared<Polar>(polar_files[k - n_aerofoils]); }
+    }, nThreads);
+    timings.aerofoils_ms = elapsed_ms(start);
+
+    for (const WingInput& input : inputs) {
+        Wing wing(input.n);
+
+        for (int i{ 0 }; i != input.sections.size(); i++) {
+            const SectionInput& s{ input.sections[i] };
+
             Section section{
-                m,
-                leading_edge,
-                chord,
-                incident,
-                aerofoil
+                s.m,
+                nc::NdArray<double>{ s.leading_edge },
+                s.chord,
+                s.incident,
+                aerofoils[s.aerofoil]
             };
+            if (s.polar >= 0) { section.polar = polars[s.polar]; }
+            section.spanwise = s.spanwise;
+            section.chordwise = s.chordwise;
 
             //section.print();
             wing.sections.push_back(section);
@@ -117,6 +340,7 @@ void Plane::read_json(std::ifstream& file) {
         }
 
         std::unique_ptr<Wing> wing_ptr = std::make_unique<Wing>(wing);
+        if (meshCached) { wing_ptr->getMesh() = cached[n_wings]; }
         wings.push_back(std::move(wing_ptr));
         n_wings++;
 
@@ -4,17 +4,43 @@
 
 #include <mesh.hpp>
 #include <aerofoil.hpp>
+#include <polar.hpp>
+#include <utils/spacing.hpp>
 
 class Mesh;
 class MultiMesh;
 class Wing;
 class Section;
 
+/// <summary>
+/// Construction runs in stages: parse the .json, load every distinct
+/// aerofoil and polar file concurrently, mesh the wings concurrently, then
+/// build the MultiMesh. Stage wall times are kept in timings.
+///
+/// With a cache directory, wing meshes are looked up in a MeshCache first;
+/// on a hit the meshing stage is skipped and aerofoils are only read if a
+/// copy of the wings is re-meshed.
+/// </summary>
 class Plane {
 
+public:
+    struct Timings {
+        double parse_ms{ 0 };
+        double aerofoils_ms{ 0 };   // aerofoil and polar files
+        double mesh_ms{ 0 };
+        double multimesh_ms{ 0 };
+        double cache_ms{ 0 };       // mesh cache lookup and store
+        double total_ms{ 0 };
+    };
+
 private:
+    int nThreads;
+    std::string cacheDir;
+    std::uint64_t cacheKey{ 0 };
+
     void read_json(std::ifstream& file);
     void calc_ref();
+    void build();
 
 public:
 
@@ -22,12 +48,23 @@ public:
     double b_ref;
     double c_ref;
 
-    MultiMesh* mesh;
+    std::unique_ptr<MultiMesh> mesh;
 
     std::vector<std::unique_ptr<Wing>> wings{};
     int n_wings{ 0 };
 
-    Plane(std::ifstream& file);
+    Timings timings;
+    bool meshCached{ false };       // meshes were read from the mesh cache
+
+    // nThreads: worker threads for loading and meshing (0: all cores). Use
+    // 1 when planes are already built on a worker pool.
+    // cacheDir: mesh cache directory, none if empty.
+    Plane(std::ifstream& file, int nThreads = 0, const std::string& cacheDir = "");
+    Plane(std::vector<std::unique_ptr<Wing>> wings, int nThreads = 0);
+
+    // Deep copy of wing definitions (aerofoils are shared) for building
+    // modified planes without re-reading input files.
+    std::vector<std::unique_ptr<Wing>> copyWings() const;
 
 };
 
@@ -60,6 +97,12 @@ public:
     double chord;
     double incident;
     std::shared_ptr<Aerofoil> aerofoil;
+    std::shared_ptr<Polar> polar{ nullptr };   // optional 2D viscous polar
+
+    // Spanwise nodes of the m panels between the previous section and this
+    // one, and chordwise nodes of this section's camber line.
+    utils::Spacing spanwise;
+    utils::Spacing chordwise;
 
     Section(
         int m,
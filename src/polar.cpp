@@ -0,0 +1,113 @@
+#include <pch.h>
+
+#include <polar.hpp>
+
+Polar::Polar(std::string filepath)
+	: filepath{ filepath }
+{
+	read_polar();
+}
+
+void Polar::read_polar()
+{
+	std::ifstream file{ filepath };
+	if (file.fail()) {
+		throw std::runtime_error("Polar not found: " + filepath);
+	}
+
+	std::vector<std::array<double, 3>> rows;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream ss{ line };
+		std::array<double, 3> row{ 0, 0, 0 };
+
+		int n_read{ 0 };
+		while (n_read != 3 && ss >> row[n_read]) { n_read++; }
+
+		// Header or separator line.
+		if (n_read < 2) { continue; }
+
+		rows.push_back(row);
+	}
+
+	if (rows.size() < 2) {
+		throw std::runtime_error(
+			"Error: Polar file '" + filepath + "' must contain at least 2 rows of"
+			" alpha, cl [, cd]."
+		);
+	}
+
+	std::sort(rows.begin(), rows.end());
+	resample(rows);
+}
+
+/// <summary>
+/// Linearly resamples polar rows (sorted in alpha) onto a uniform grid at the
+/// finest input spacing, and finds zero lift and stall angles.
+/// </summary>
+void Polar::resample(const std::vector<std::array<double, 3>>& rows)
+{
+	double span{ rows.back()[0] - rows.front()[0] };
+	if (span <= 0) {
+		throw std::runtime_error(
+			"Error: Polar file '" + filepath + "' must span a range of alpha.");
+	}
+
+	dalpha = span;
+	for (int i{ 1 }; i != rows.size(); i++) {
+		double d{ rows[i][0] - rows[i - 1][0] };
+		if (d > 0) { dalpha = std::min(dalpha, d); }
+	}
+	dalpha = std::max(dalpha, 1e-3 * span);
+	alpha0 = rows.front()[0];
+
+	int n{ (int)std::ceil(span / dalpha - 1e-9) + 1 };
+	cl_table.resize(n);
+	cd_table.resize(n);
+
+	int j{ 1 };
+	for (int i{ 0 }; i != n; i++)
+	{
+		double alpha{ std::min(alpha0 + i * dalpha, rows.back()[0]) };
+		while (j != rows.size() - 1 && rows[j][0] < alpha) { j++; }
+
+		const std::array<double, 3>& r0{ rows[j - 1] };
+		const std::array<double, 3>& r1{ rows[j] };
+		double t{ r1[0] != r0[0] ? (alpha - r0[0]) / (r1[0] - r0[0]) : 0 };
+
+		cl_table[i] = r0[1] + t * (r1[1] - r0[1]);
+		cd_table[i] = r0[2] + t * (r1[2] - r0[2]);
+	}
+
+	// Stall - first maximum of cl.
+	int i_max{ (int)(std::max_element(cl_table.begin(), cl_table.end()) - cl_table.begin()) };
+	cl_max = cl_table[i_max];
+	alpha_stall = alpha0 + i_max * dalpha;
+
+	// Zero lift - cl sign change below stall.
+	alpha_zero_lift = alpha0;
+	for (int i{ 1 }; i <= i_max; i++) {
+		if (cl_table[i - 1] <= 0 && cl_table[i] > 0) {
+			double t{ -cl_table[i - 1] / (cl_table[i] - cl_table[i - 1]) };
+			alpha_zero_lift = alpha0 + (i - 1 + t) * dalpha;
+			break;
+		}
+	}
+}
+
+void Polar::lookup(const double* alpha, double* cl, double* cd, int n) const
+{
+	const int last{ (int)cl_table.size() - 1 };
+	const double inv_dalpha{ 1 / dalpha };
+
+	for (int k{ 0 }; k != n; k++)
+	{
+		double u{ std::clamp((alpha[k] - alpha0) * inv_dalpha, 0.0, (double)last) };
+		int i{ std::min((int)u, last - 1) };
+		double t{ u - i };
+
+		cl[k] = cl_table[i] + t * (cl_table[i + 1] - cl_table[i]);
+		cd[k] = cd_table[i] + t * (cd_table[i + 1] - cd_table[i]);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <pch.h>
+
+/// <summary>
+/// 2D section polar (cl, cd against alpha) read from a text file, e.g. XFOIL
+/// polar output. Rows of at least 2 numbers are read as alpha (deg), cl and
+/// optionally cd - header lines are skipped.
+///
+/// Data is resampled onto a uniform alpha grid so a lookup is index
+/// arithmetic and a lerp with no search or branches.
+/// </summary>
+class Polar
+{
+private:
+	std::string filepath;
+
+	double alpha0{ 0 };		// first grid angle (deg)
+	double dalpha{ 1 };		// grid spacing (deg)
+	std::vector<double> cl_table;
+	std::vector<double> cd_table;
+
+	double alpha_zero_lift{ 0 };
+	double alpha_stall{ 0 };
+	double cl_max{ 0 };
+
+	void read_polar();
+	void resample(const std::vector<std::array<double, 3>>& rows);
+
+public:
+	Polar(std::string filepath);
+
+	/// <summary>
+	/// Looks up n angles at once. Angles outside the polar are clamped to
+	/// its ends.
+	/// </summary>
+	void lookup(const double* alpha, double* cl, double* cd, int n) const;
+
+	double getZeroLiftAlpha() const { return alpha_zero_lift; }
+	double getStallAlpha() const { return alpha_stall; }
+	double getClMax() const { return cl_max; }
+	const std::string get_filepath() const { return filepath; }
+};
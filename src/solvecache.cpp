@@ -0,0 +1,198 @@
+#include <pch.h>
+
+#include <cstring>
+#include <iomanip>
+
+#include <solvecache.hpp>
+#include <utils/mapped_file.hpp>
+
+namespace
+{
+    constexpr char magic[8]{ 'V', 'L', 'M', 'S', 'O', 'L', 'V', '\1' };
+    constexpr std::size_t alignment{ 64 };
+
+    std::size_t aligned(std::size_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+SolveCache::SolveCache(const std::string& directory, std::uintmax_t quota)
+    : directory{ directory }
+    , quota{ quota }
+{
+    std::error_code err;
+    std::filesystem::create_directories(this->directory, err);
+}
+
+std::filesystem::path SolveCache::path(std::uint64_t key) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".lu";
+    return directory / name.str();
+}
+
+SolveCache::Layout SolveCache::layout(int n)
+{
+    const std::size_t N{ (std::size_t)n };
+
+    Layout l;
+    l.pivots = aligned(sizeof(Header));
+    l.factors = aligned(l.pivots + N * sizeof(std::int32_t));
+    l.b = aligned(l.factors + N * N * sizeof(double));
+    l.size = l.b + N * N * sizeof(double);
+    return l;
+}
+
+/// <summary>
+/// Maps an entry and checks it against the expected size. Any mismatch or
+/// read error is a miss.
+/// </summary>
+bool SolveCache::load(std::uint64_t key, int n, utils::LU& lu, nc::NdArray<double>& b)
+{
+    static_assert(sizeof(int) == sizeof(std::int32_t));
+
+    const std::filesystem::path file{ path(key) };
+
+    std::error_code err;
+    if (!std::filesystem::exists(file, err)) { return false; }
+
+    std::shared_ptr<utils::MappedFile> mapping;
+    try {
+        mapping = std::make_shared<utils::MappedFile>(file.string());
+    }
+    catch (const std::runtime_error&) {
+        return false;
+    }
+
+    const Layout l{ layout(n) };
+    if (mapping->size() != l.size) { return false; }
+
+    Header header;
+    std::memcpy(&header, mapping->data(), sizeof(Header));
+    if (
+        std::memcmp(header.magic, magic, sizeof(magic)) != 0
+        || header.key != key
+        || header.version != version
+        || header.n != (std::uint32_t)n
+        )
+    {
+        return false;
+    }
+
+    const char* data{ mapping->data() };
+    b = nc::zeros<double>(n, n);
+    std::memcpy(b.data(), data + l.b, (std::size_t)n * n * sizeof(double));
+
+    lu = utils::LU{
+        mapping,
+        reinterpret_cast<const double*>(data + l.factors),
+        reinterpret_cast<const int*>(data + l.pivots),
+        n
+    };
+
+    // Most recently used.
+    std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), err);
+
+    return true;
+}
+
+bool SolveCache::store(std::uint64_t key, const utils::LU& lu, const nc::NdArray<double>& b)
+{
+    const int n{ lu.size() };
+    const Layout l{ layout(n) };
+    if (l.size > quota) { return false; }
+
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        evict(l.size);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.key = key;
+    header.version = version;
+    header.n = (std::uint32_t)n;
+
+    // Unique temporary name per writer.
+    static std::atomic<std::uint64_t> counter{ 0 };
+    std::uint64_t unique{ std::random_device{}() ^ (counter++ << 32) };
+
+    const std::filesystem::path file{ path(key) };
+    std::filesystem::path tmp{ file };
+    tmp += "." + std::to_string(unique) + ".tmp";
+
+    {
+        std::ofstream f{ tmp, std::ios::binary };
+        const char zeros[alignment]{};
+        std::size_t position{ 0 };
+
+        auto write = [&](std::size_t offset, const void* data, std::size_t bytes) {
+            f.write(zeros, (std::streamsize)(offset - position));
+            f.write(static_cast<const char*>(data), (std::streamsize)bytes);
+            position = offset + bytes;
+        };
+
+        const std::size_t N{ (std::size_t)n };
+        write(0, &header, sizeof(Header));
+        write(l.pivots, lu.pivots(), N * sizeof(std::int32_t));
+        write(l.factors, lu.factors(), N * N * sizeof(double));
+        write(l.b, b.data(), N * N * sizeof(double));
+
+        if (!f) {
+            f.close();
+            std::error_code err;
+            std::filesystem::remove(tmp, err);
+            return false;
+        }
+    }
+
+    std::error_code err;
+    std::filesystem::rename(tmp, file, err);
+    if (err) {
+        std::filesystem::remove(tmp, err);
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Removes least recently used entries until incoming more bytes fit in the
+/// quota. Entries that cannot be removed (e.g. mapped on Windows) are
+/// skipped.
+/// </summary>
+void SolveCache::evict(std::uintmax_t incoming)
+{
+    struct Entry {
+        std::filesystem::path path;
+        std::uintmax_t size;
+        std::filesystem::file_time_type used;
+    };
+
+    std::vector<Entry> entries;
+    std::uintmax_t total{ 0 };
+
+    std::error_code err;
+    for (const auto& item : std::filesystem::directory_iterator{ directory, err })
+    {
+        if (item.path().extension() != ".lu") { continue; }
+
+        std::error_code item_err;
+        Entry entry{ item.path(), item.file_size(item_err), item.last_write_time(item_err) };
+        if (item_err) { continue; }
+
+        total += entry.size;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.used < b.used; });
+
+    for (const Entry& entry : entries)
+    {
+        if (total + incoming <= quota) { break; }
+
+        if (std::filesystem::remove(entry.path, err)) { total -= entry.size; }
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <pch.h>
+
+#include <filesystem>
+
+#include <utils/linalg.hpp>
+
+/// <summary>
+/// On-disk store of factorised influence matrices, so a repeated solve of
+/// an unchanged lattice is a file map plus triangular solves instead of an
+/// O(N^2) assembly and O(N^3) factorisation. The key is supplied by the
+/// solver from everything the matrices depend on (see Vlm::influenceKey).
+///
+/// Entry file <key>.lu (native byte order, buffers 64-byte aligned):
+///     Header
+///     int32 pivots[N]
+///     double LU factors[N x N]        row-major, see utils::LU
+///     double wake downwash b[N x N]   row-major
+/// The LU factors are used in place from the mapping; b is copied out.
+///
+/// Entries are evicted least recently used first (by file modification
+/// time, refreshed on every hit) to keep the directory's .lu files within
+/// quota. Stores go through a temporary file and a rename, so concurrent
+/// processes sharing a directory never read a partial entry.
+/// </summary>
+class SolveCache {
+public:
+    // Bump when the lattice kernels or the file layout change.
+    static constexpr std::uint32_t version{ 1 };
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint64_t key;
+        std::uint32_t version;
+        std::uint32_t n;
+    };
+
+    struct Layout {
+        std::size_t pivots;
+        std::size_t factors;
+        std::size_t b;
+        std::size_t size;
+    };
+
+    std::filesystem::path directory;
+    std::uintmax_t quota;
+
+    std::mutex mutex;
+
+    std::filesystem::path path(std::uint64_t key) const;
+    static Layout layout(int n);
+    void evict(std::uintmax_t incoming);
+
+public:
+    // quota: bytes of .lu files kept in directory.
+    SolveCache(const std::string& directory, std::uintmax_t quota);
+
+    SolveCache(const SolveCache&) = delete;
+    SolveCache& operator=(const SolveCache&) = delete;
+
+    // On a hit, lu views the mapped factors and b (N x N) is filled.
+    bool load(std::uint64_t key, int n, utils::LU& lu, nc::NdArray<double>& b);
+
+    // Returns false if the entry is larger than the quota or could not be
+    // written.
+    bool store(std::uint64_t key, const utils::LU& lu, const nc::NdArray<double>& b);
+
+};
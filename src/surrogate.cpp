@@ -0,0 +1,622 @@
+#include <pch.h>
+
+#include <surrogate.hpp>
+#include <vlm.hpp>
+#include <utils/linalg.hpp>
+
+using json = nlohmann::json;
+
+Surrogate::Surrogate(std::vector<SurrogateParameter> parameters)
+    : parameters{ parameters }
+    , nDims{ (int)parameters.size() }
+{
+
+}
+
+// Maps physical parameters onto the unit box.
+void Surrogate::toUnit(const double* params, double* x) const
+{
+    for (int k{ 0 }; k != nDims; k++) {
+        const SurrogateParameter& p{ parameters[k] };
+        double range{ p.max - p.min };
+        x[k] = range != 0 ? (params[k] - p.min) / range : 0;
+    }
+}
+
+// Matern 5/2 covariance.
+double Surrogate::kernel(const double* x0, const double* x1) const
+{
+    double r2{ 0 };
+    for (int k{ 0 }; k != nDims; k++) {
+        double dx{ x0[k] - x1[k] };
+        r2 += dx * dx;
+    }
+    double r{ std::sqrt(5 * r2) / lengthScale };
+
+    return (1 + r + r * r / 3) * std::exp(-r);
+}
+
+/// <summary>
+/// Fits linear trends by least squares, then the residual process. The
+/// length scale is chosen from a fixed ladder by leave-one-out error, which
+/// for kriging is available in closed form: e_i = w_i / (K^-1)_ii.
+/// </summary>
+void Surrogate::fit(
+    const std::vector<double>& samples,
+    const std::vector<double>& CL,
+    const std::vector<double>& CDi
+)
+{
+    const int M{ (int)CL.size() };
+    const int d{ nDims };
+    nSamples = M;
+
+    X.resize((size_t)M * d);
+    for (int i{ 0 }; i != M; i++) {
+        toUnit(&samples[(size_t)i * d], &X[(size_t)i * d]);
+    }
+
+    std::array<const std::vector<double>*, 2> Y{ &CL, &CDi };
+    std::array<std::vector<double>, 2> residuals;
+    std::array<double, 2> y_scale;
+
+    // Linear trend: normal equations of [1, x] basis.
+    for (int o{ 0 }; o != 2; o++)
+    {
+        const std::vector<double>& y{ *Y[o] };
+        const int nb{ d + 1 };
+
+        std::vector<double> A((size_t)nb * nb, 0);
+        std::vector<double> beta(nb, 0);
+        for (int i{ 0 }; i != M; i++)
+        {
+            const double* x{ &X[(size_t)i * d] };
+            for (int r{ 0 }; r != nb; r++) {
+                double phi_r{ r == 0 ? 1 : x[r - 1] };
+                beta[r] += phi_r * y[i];
+                for (int c{ 0 }; c != nb; c++) {
+                    double phi_c{ c == 0 ? 1 : x[c - 1] };
+                    A[(size_t)r * nb + c] += phi_r * phi_c;
+                }
+            }
+        }
+        // Small ridge keeps under-sampled trends solvable.
+        for (int r{ 0 }; r != nb; r++) { A[(size_t)r * nb + r] += 1e-12 * M; }
+
+        utils::LU{ std::move(A), nb }.solve(beta.data());
+        outputs[o].trend = beta;
+
+        residuals[o].resize(M);
+        double mean{ 0 };
+        for (int i{ 0 }; i != M; i++) { mean += y[i] / M; }
+
+        double var{ 0 };
+        for (int i{ 0 }; i != M; i++)
+        {
+            const double* x{ &X[(size_t)i * d] };
+            double t{ beta[0] };
+            for (int k{ 0 }; k != d; k++) { t += beta[k + 1] * x[k]; }
+            residuals[o][i] = y[i] - t;
+            var += (y[i] - mean) * (y[i] - mean) / M;
+        }
+        y_scale[o] = var > 0 ? std::sqrt(var) : 1;
+    }
+
+    // Length scale ladder in unit box coordinates.
+    const std::array<double, 9> ladder{ 0.1, 0.2, 0.35, 0.5, 0.75, 1, 1.5, 2, 3 };
+
+    double best_score{ std::numeric_limits<double>::max() };
+    double best_l{ 0 };
+    std::vector<double> Kinv_l((size_t)M * M);
+    for (double l : ladder)
+    {
+        lengthScale = l;
+
+        std::vector<double> K((size_t)M * M);
+        for (int i{ 0 }; i != M; i++) {
+            for (int j{ 0 }; j != M; j++) {
+                K[(size_t)i * M + j] = kernel(&X[(size_t)i * d], &X[(size_t)j * d]);
+            }
+            K[(size_t)i * M + i] += nugget;
+        }
+
+        utils::LU K_lu;
+        try {
+            K_lu = utils::LU{ std::move(K), M };
+        }
+        catch (const std::runtime_error&) {
+            continue;
+        }
+
+        // Explicit inverse - needed for predictive variance.
+        std::vector<double> col(M);
+        for (int j{ 0 }; j != M; j++) {
+            std::fill(col.begin(), col.end(), 0);
+            col[j] = 1;
+            K_lu.solve(col.data());
+            for (int i{ 0 }; i != M; i++) { Kinv_l[(size_t)i * M + j] = col[i]; }
+        }
+
+        std::array<std::vector<double>, 2> w;
+        std::array<double, 2> loo{ 0, 0 };
+        double score{ 0 };
+        for (int o{ 0 }; o != 2; o++) {
+            w[o] = residuals[o];
+            K_lu.solve(w[o].data());
+
+            for (int i{ 0 }; i != M; i++) {
+                double e{ w[o][i] / Kinv_l[(size_t)i * M + i] };
+                loo[o] += e * e / M;
+            }
+            loo[o] = std::sqrt(loo[o]);
+            score += loo[o] / y_scale[o];
+        }
+
+        if (score < best_score)
+        {
+            best_score = score;
+            best_l = l;
+            Kinv.swap(Kinv_l);
+            Kinv_l.resize((size_t)M * M);
+
+            for (int o{ 0 }; o != 2; o++) {
+                outputs[o].weights = w[o];
+                outputs[o].looError = loo[o];
+
+                double rKr{ 0 };
+                for (int i{ 0 }; i != M; i++) { rKr += residuals[o][i] * w[o][i]; }
+                outputs[o].variance = std::max(rKr / M, 0.0);
+            }
+        }
+    }
+
+    // Every kernel matrix singular or every score NaN: nothing to predict
+    // from.
+    if (best_l == 0) {
+        throw std::runtime_error("Surrogate: no length scale gave a usable fit.");
+    }
+
+    lengthScale = best_l;
+}
+
+Surrogate::Prediction Surrogate::predict(const double* params, bool withError) const
+{
+    const int M{ nSamples };
+    const int d{ nDims };
+
+    // Scratch reused between queries - nothing is allocated per query.
+    thread_local std::vector<double> x;
+    thread_local std::vector<double> k_x;
+    x.resize(d);
+    k_x.resize(M);
+
+    toUnit(params, x.data());
+    for (int i{ 0 }; i != M; i++) {
+        k_x[i] = kernel(x.data(), &X[(size_t)i * d]);
+    }
+
+    std::array<double, 2> mean;
+    for (int o{ 0 }; o != 2; o++)
+    {
+        const Output& out{ outputs[o] };
+        double m{ out.trend[0] };
+        for (int k{ 0 }; k != d; k++) { m += out.trend[k + 1] * x[k]; }
+        for (int i{ 0 }; i != M; i++) { m += k_x[i] * out.weights[i]; }
+        mean[o] = m;
+    }
+
+    Prediction prediction;
+    prediction.CL = mean[0];
+    prediction.CDi = mean[1];
+
+    if (withError)
+    {
+        // k_x^T K^-1 k_x
+        double kKk{ 0 };
+        for (int i{ 0 }; i != M; i++) {
+            const double* Kinv_i{ &Kinv[(size_t)i * M] };
+            double s{ 0 };
+            for (int j{ 0 }; j != M; j++) { s += Kinv_i[j] * k_x[j]; }
+            kKk += k_x[i] * s;
+        }
+        double reduction{ std::max(1 + nugget - kKk, 0.0) };
+
+        prediction.CL_error = std::sqrt(outputs[0].variance * reduction);
+        prediction.CDi_error = std::sqrt(outputs[1].variance * reduction);
+    }
+
+    return prediction;
+}
+
+namespace
+{
+    template <class T>
+    void write(std::ofstream& file, const T& value) {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    void write(std::ofstream& file, const std::vector<T>& values) {
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <class T>
+    void read(std::ifstream& file, T& value) {
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    void read(std::ifstream& file, std::vector<T>& values, size_t n) {
+        values.resize(n);
+        file.read(reinterpret_cast<char*>(values.data()), n * sizeof(T));
+    }
+
+    const char surrogateMagic[8]{ 'V','L','M','S','U','R','R','1' };
+}
+
+/// <summary>
+/// Binary layout (native endianness):
+///     magic[8], d, M, lengthScale, nugget,
+///     d x { type, wing, section, min, max },
+///     X[M*d], Kinv[M*M], 2 x { trend[d+1], weights[M], variance, looError }
+/// </summary>
+void Surrogate::save(const std::string& filepath) const
+{
+    std::ofstream file{ filepath, std::ios::binary };
+    if (file.fail()) {
+        throw std::runtime_error("Cannot write surrogate: " + filepath);
+    }
+
+    file.write(surrogateMagic, sizeof(surrogateMagic));
+    write(file, (int32_t)nDims);
+    write(file, (int32_t)nSamples);
+    write(file, lengthScale);
+    write(file, nugget);
+
+    for (const SurrogateParameter& p : parameters) {
+        write(file, (int32_t)p.type);
+        write(file, (int32_t)p.wing);
+        write(file, (int32_t)p.section);
+        write(file, p.min);
+        write(file, p.max);
+    }
+
+    write(file, X);
+    write(file, Kinv);
+    for (const Output& out : outputs) {
+        write(file, out.trend);
+        write(file, out.weights);
+        write(file, out.variance);
+        write(file, out.looError);
+    }
+}
+
+Surrogate Surrogate::load(const std::string& filepath)
+{
+    std::ifstream file{ filepath, std::ios::binary };
+    if (file.fail()) {
+        throw std::runtime_error("Surrogate not found: " + filepath);
+    }
+
+    char magic[8];
+    file.read(magic, sizeof(magic));
+    if (!std::equal(magic, magic + 8, surrogateMagic)) {
+        throw std::runtime_error("Not a surrogate file: " + filepath);
+    }
+
+    file.seekg(0, std::ios::end);
+    const std::uint64_t bytes{ (std::uint64_t)file.tellg() };
+    file.seekg(sizeof(magic));
+
+    int32_t d, M;
+    read(file, d);
+    read(file, M);
+
+    // Counts must match the file length before anything is allocated.
+    // M * M and M * d fit in 64 bits for any positive int32.
+    const std::uint64_t d_{ (std::uint64_t)d };
+    const std::uint64_t M_{ (std::uint64_t)M };
+    if (
+        file.fail() || d <= 0 || M <= 0
+        || M_ * M_ > bytes / sizeof(double) || M_ * d_ > bytes / sizeof(double)
+        || 32 + 28 * d_ + 8 * (M_ * d_ + M_ * M_) + 2 * (8 * (d_ + 1) + 8 * M_ + 16) != bytes
+        )
+    {
+        throw std::runtime_error("Surrogate file is corrupt: " + filepath);
+    }
+
+    Surrogate surrogate;
+    surrogate.nDims = d;
+    surrogate.nSamples = M;
+    read(file, surrogate.lengthScale);
+    read(file, surrogate.nugget);
+
+    for (int k{ 0 }; k != d; k++) {
+        SurrogateParameter p;
+        int32_t type, wing, section;
+        read(file, type);
+        read(file, wing);
+        read(file, section);
+        read(file, p.min);
+        read(file, p.max);
+
+        p.type = (SurrogateParameter::Type)type;
+        p.wing = wing;
+        p.section = section;
+        surrogate.parameters.push_back(p);
+    }
+
+    read(file, surrogate.X, (size_t)M * d);
+    read(file, surrogate.Kinv, (size_t)M * M);
+    for (Output& out : surrogate.outputs) {
+        read(file, out.trend, (size_t)d + 1);
+        read(file, out.weights, (size_t)M);
+        read(file, out.variance);
+        read(file, out.looError);
+    }
+
+    if (file.fail()) {
+        throw std::runtime_error("Surrogate file is truncated: " + filepath);
+    }
+
+    return surrogate;
+}
+
+SurrogateBuilder::SurrogateBuilder(std::ifstream& spec)
+{
+    read_spec(spec);
+}
+
+/// <summary>
+/// Reads surrogate spec and the nominal plane. See surrogate.hpp for layout.
+/// </summary>
+/// <param name="file"> {std::ifstream}: Input .json filestream.</param>
+void SurrogateBuilder::read_spec(std::ifstream& file)
+{
+    json j_spec = json::parse(file);
+    file.close();
+
+    std::string plane_file = j_spec["plane"];
+    std::ifstream f{ plane_file };
+    if (f.fail()) {
+        throw std::runtime_error("Plane file not found: " + plane_file);
+    }
+    nominal = std::make_unique<Plane>(f);
+
+    Qinf = j_spec.value("Qinf", Qinf);
+    rho = j_spec.value("rho", rho);
+    alpha = j_spec.value("alpha", alpha);
+    beta = j_spec.value("beta", beta);
+
+    int hardware_threads{ (int)std::thread::hardware_concurrency() };
+    nInitial = j_spec.value("initial_samples", nInitial);
+    maxSamples = j_spec.value("max_samples", maxSamples);
+    batchSize = std::max(j_spec.value("batch", batchSize), 1);
+    nCandidates = j_spec.value("candidates", nCandidates);
+    tolerance = j_spec.value("tolerance", tolerance);
+    nThreads = std::max(j_spec.value("threads", std::max(hardware_threads, 1)), 1);
+    seed = j_spec.value("seed", seed);
+
+    for (auto& j_p : j_spec["parameters"]) {
+        SurrogateParameter p;
+
+        std::string type = j_p["type"];
+        if (type == "alpha") { p.type = SurrogateParameter::Type::alpha; }
+        else if (type == "beta") { p.type = SurrogateParameter::Type::beta; }
+        else if (type == "incident") {
+            p.type = SurrogateParameter::Type::incident;
+            p.wing = j_p.value("wing", 0);
+            p.section = j_p.value("section", 0);
+
+            if (p.wing < 0 || p.wing >= nominal->n_wings ||
+                p.section < 0 || p.section >= nominal->wings[p.wing]->n_sections)
+            {
+                throw std::invalid_argument(
+                    "Surrogate parameter references a wing/section not in " + plane_file);
+            }
+        }
+        else {
+            throw std::invalid_argument("Unknown surrogate parameter: " + type);
+        }
+
+        p.min = j_p["min"];
+        p.max = j_p["max"];
+
+        parameters.push_back(p);
+    }
+
+    if (parameters.empty()) {
+        throw std::invalid_argument("Surrogate spec has no parameters.");
+    }
+}
+
+/// <summary>
+/// Full VLM solve at one point of the parameter box.
+/// </summary>
+/// <returns>{CL, CDi}</returns>
+std::array<double, 2> SurrogateBuilder::evaluate(const double* params) const
+{
+    double alpha_{ alpha };
+    double beta_{ beta };
+
+    // Each evaluation gets its own plane - panels hold solver output.
+    std::vector<std::unique_ptr<Wing>> wings{ nominal->copyWings() };
+    for (int k{ 0 }; k != (int)parameters.size(); k++)
+    {
+        const SurrogateParameter& p{ parameters[k] };
+        switch (p.type)
+        {
+        case SurrogateParameter::Type::alpha: alpha_ = params[k]; break;
+        case SurrogateParameter::Type::beta: beta_ = params[k]; break;
+        case SurrogateParameter::Type::incident:
+            wings[p.wing]->sections[p.section].incident = params[k];
+            break;
+        }
+    }
+
+    Plane plane{ std::move(wings), 1 };
+    Vlm vlm{ &plane, false };
+    vlm.setThreads(1);      // evaluated on a worker pool
+    vlm.runHorseshoe(Qinf, alpha_, beta_, rho);
+
+    return { vlm.CL, vlm.CDi };
+}
+
+/// <summary>
+/// Evaluates a batch of points (row-major) on a worker pool. Failed points
+/// are returned as NaN.
+/// </summary>
+void SurrogateBuilder::evaluateBatch(
+    const std::vector<double>& batch,
+    std::vector<double>& CL, std::vector<double>& CDi
+) const
+{
+    const int d{ (int)parameters.size() };
+    const int n{ (int)batch.size() / d };
+    CL.assign(n, 0);
+    CDi.assign(n, 0);
+
+    std::atomic<int> next{ 0 };
+    auto worker = [&]() {
+        for (int i{ next++ }; i < n; i = next++) {
+            try {
+                std::array<double, 2> result{ evaluate(&batch[(size_t)i * d]) };
+                CL[i] = result[0];
+                CDi[i] = result[1];
+            }
+            catch (const std::exception&) {
+                CL[i] = std::numeric_limits<double>::quiet_NaN();
+                CDi[i] = std::numeric_limits<double>::quiet_NaN();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i{ 0 }; i != std::min(nThreads, n); i++) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+/// <summary>
+/// Latin hypercube start, then rounds of refit + evaluate the candidates with
+/// the largest normalised error estimate. Logs one JSON line per round.
+/// </summary>
+Surrogate SurrogateBuilder::build(std::ostream& log)
+{
+    const int d{ (int)parameters.size() };
+    std::mt19937_64 rng{ seed };
+    std::uniform_real_distribution<double> uniform{ 0, 1 };
+
+    auto toPhysical = [&](int k, double u) {
+        return parameters[k].min + u * (parameters[k].max - parameters[k].min);
+    };
+
+    // Latin hypercube.
+    std::vector<double> batch((size_t)nInitial * d);
+    for (int k{ 0 }; k != d; k++)
+    {
+        std::vector<int> strata(nInitial);
+        for (int i{ 0 }; i != nInitial; i++) { strata[i] = i; }
+        std::shuffle(strata.begin(), strata.end(), rng);
+
+        for (int i{ 0 }; i != nInitial; i++) {
+            double u{ (strata[i] + uniform(rng)) / nInitial };
+            batch[(size_t)i * d + k] = toPhysical(k, u);
+        }
+    }
+
+    std::vector<double> samples;
+    std::vector<double> CL;
+    std::vector<double> CDi;
+
+    Surrogate surrogate{ parameters };
+    auto start{ std::chrono::high_resolution_clock::now() };
+    for (int round{ 0 }; ; round++)
+    {
+        std::vector<double> CL_batch, CDi_batch;
+        evaluateBatch(batch, CL_batch, CDi_batch);
+
+        const std::size_t M_prev{ CL.size() };
+        for (int i{ 0 }; i != (int)CL_batch.size(); i++) {
+            if (std::isnan(CL_batch[i])) { continue; }
+            samples.insert(samples.end(), &batch[(size_t)i * d], &batch[(size_t)(i + 1) * d]);
+            CL.push_back(CL_batch[i]);
+            CDi.push_back(CDi_batch[i]);
+        }
+        if (CL.empty()) {
+            throw std::runtime_error("Surrogate: every sample failed to solve.");
+        }
+
+        // A round that adds nothing would refit the same surrogate forever.
+        if (round > 0 && CL.size() == M_prev) {
+            log << json{ { "round", round }, { "stopped", "no new samples solved" } }.dump() << std::endl;
+            break;
+        }
+
+        surrogate.fit(samples, CL, CDi);
+        const int M{ (int)CL.size() };
+
+        // Output ranges normalise the error estimates.
+        auto [CL_min, CL_max] = std::minmax_element(CL.begin(), CL.end());
+        auto [CDi_min, CDi_max] = std::minmax_element(CDi.begin(), CDi.end());
+        double CL_scale{ std::max(*CL_max - *CL_min, 1e-12) };
+        double CDi_scale{ std::max(*CDi_max - *CDi_min, 1e-12) };
+
+        // Score random candidates by normalised error estimate.
+        std::vector<std::pair<double, int>> scores(nCandidates);
+        std::vector<double> candidates((size_t)nCandidates * d);
+        for (int c{ 0 }; c != nCandidates; c++)
+        {
+            double* x{ &candidates[(size_t)c * d] };
+            for (int k{ 0 }; k != d; k++) { x[k] = toPhysical(k, uniform(rng)); }
+
+            Surrogate::Prediction pred{ surrogate.predict(x) };
+            scores[c] = {
+                std::max(pred.CL_error / CL_scale, pred.CDi_error / CDi_scale), c };
+        }
+        std::sort(scores.begin(), scores.end(), std::greater<>());
+        double max_error{ nCandidates > 0 ? scores[0].first : 0 };
+
+        std::chrono::duration<double> elapsed{ std::chrono::high_resolution_clock::now() - start };
+        json record;
+        record["round"] = round;
+        record["samples"] = M;
+        record["max_error"] = max_error;
+        record["loo_CL"] = surrogate.getLooError(0);
+        record["loo_CDi"] = surrogate.getLooError(1);
+        record["elapsed_s"] = elapsed.count();
+        log << record.dump() << std::endl;
+
+        if (max_error < tolerance || M >= maxSamples || nCandidates == 0) { break; }
+
+        // Greedy pick of the worst candidates, kept apart so one batch does
+        // not cluster on a single error peak.
+        double r_min{ 0.25 * std::pow(1.0 / M, 1.0 / d) };
+        int n_batch{ std::min(batchSize, maxSamples - M) };
+
+        batch.clear();
+        for (auto& [error, c] : scores)
+        {
+            if ((int)batch.size() / d == n_batch) { break; }
+
+            const double* x{ &candidates[(size_t)c * d] };
+            bool isolated{ true };
+            for (int b{ 0 }; b != (int)batch.size() / d && isolated; b++) {
+                double r2{ 0 };
+                for (int k{ 0 }; k != d; k++) {
+                    double range{ parameters[k].max - parameters[k].min };
+                    double dx{ range != 0 ? (x[k] - batch[(size_t)b * d + k]) / range : 0 };
+                    r2 += dx * dx;
+                }
+                isolated = r2 > r_min * r_min;
+            }
+
+            if (isolated) { batch.insert(batch.end(), x, x + d); }
+        }
+    }
+
+    return surrogate;
+}
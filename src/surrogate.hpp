@@ -0,0 +1,133 @@
+#pragma once
+
+#include <pch.h>
+
+#include <plane.hpp>
+
+/// <summary>
+/// Input dimension of a surrogate. incident sets the absolute incidence of
+/// one section (deg).
+/// </summary>
+struct SurrogateParameter {
+    enum class Type { alpha, beta, incident };
+
+    Type type{ Type::alpha };
+    int wing{ 0 };
+    int section{ 0 };
+    double min{ 0 };
+    double max{ 0 };
+};
+
+/// <summary>
+/// Kriging surrogate of CL and CDi over a box of flight/geometry parameters.
+/// Each output is a linear trend plus a Gaussian process (Matern 5/2 kernel)
+/// on the residuals, which gives a prediction and an error estimate
+/// (predictive standard deviation). A query costs O(M d), or O(M^2) with the
+/// error estimate, for M samples.
+/// </summary>
+class Surrogate {
+public:
+    struct Prediction {
+        double CL{ 0 };
+        double CDi{ 0 };
+        double CL_error{ 0 };
+        double CDi_error{ 0 };
+    };
+
+private:
+    // Per output fitted data.
+    struct Output {
+        std::vector<double> trend;      // [c, dy/dx_0, ...] in unit coordinates
+        std::vector<double> weights;    // K^-1 (y - trend)
+        double variance{ 0 };           // process variance
+        double looError{ 0 };           // leave-one-out RMS error
+    };
+
+    std::vector<SurrogateParameter> parameters;
+    int nDims{ 0 };
+    int nSamples{ 0 };
+    double lengthScale{ 1 };
+    double nugget{ 1e-10 };
+
+    std::vector<double> X;      // samples in unit box (M x d)
+    std::vector<double> Kinv;   // inverse kernel matrix (M x M)
+    std::array<Output, 2> outputs;
+
+    void toUnit(const double* params, double* x) const;
+    double kernel(const double* x0, const double* x1) const;
+
+public:
+    Surrogate() = default;
+    Surrogate(std::vector<SurrogateParameter> parameters);
+
+    // Fits to samples given in physical units (M x d, row-major).
+    void fit(
+        const std::vector<double>& samples,
+        const std::vector<double>& CL,
+        const std::vector<double>& CDi
+    );
+
+    Prediction predict(const double* params, bool withError = true) const;
+    Prediction predict(const std::vector<double>& params, bool withError = true) const {
+        return predict(params.data(), withError);
+    }
+
+    void save(const std::string& filepath) const;
+    static Surrogate load(const std::string& filepath);
+
+    const std::vector<SurrogateParameter>& getParameters() const { return parameters; }
+    int size() const { return nSamples; }
+    double getLooError(int output) const { return outputs[output].looError; }
+
+};
+
+/// <summary>
+/// Adaptively samples runHorseshoe over a parameter box and fits a
+/// Surrogate. Starts from a Latin hypercube, then each round evaluates (in
+/// parallel) the candidates with the largest predicted error until the
+/// normalised error estimate falls below tolerance.
+///
+/// Spec layout:
+/// {
+///     "plane": "wing.json", "Qinf": 1, "rho": 1.225, "alpha": 0, "beta": 0,
+///     "parameters": [
+///         { "type": "alpha", "min": -4, "max": 10 },
+///         { "type": "beta", "min": 0, "max": 5 },
+///         { "type": "incident", "wing": 0, "section": 2, "min": -3, "max": 3 }
+///     ],
+///     "initial_samples": 20, "max_samples": 200, "batch": 8,
+///     "candidates": 2000, "tolerance": 1e-3, "threads": 8, "seed": 1
+/// }
+/// alpha/beta outside "parameters" are held at the given fixed values.
+/// </summary>
+class SurrogateBuilder {
+private:
+    std::unique_ptr<Plane> nominal;
+    std::vector<SurrogateParameter> parameters;
+
+    double Qinf{ 1 };
+    double rho{ 1.225 };
+    double alpha{ 0 };
+    double beta{ 0 };
+
+    int nInitial{ 20 };
+    int maxSamples{ 200 };
+    int batchSize{ 8 };
+    int nCandidates{ 2000 };
+    double tolerance{ 1e-3 };
+    int nThreads{ 1 };
+    unsigned long long seed{ 1 };
+
+    void read_spec(std::ifstream& file);
+    std::array<double, 2> evaluate(const double* params) const;
+    void evaluateBatch(
+        const std::vector<double>& batch,
+        std::vector<double>& CL, std::vector<double>& CDi
+    ) const;
+
+public:
+    SurrogateBuilder(std::ifstream& spec);
+
+    Surrogate build(std::ostream& log);
+
+};
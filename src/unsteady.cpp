@@ -0,0 +1,228 @@
+#include <pch.h>
+
+#include <unsteady.hpp>
+#include <utils/hash.hpp>
+
+Unsteady::Unsteady(
+    Plane* plane, double Qinf, double alpha, double beta, double atmosphereDensity,
+    double dt, int nThreads, Wake::Options wakeOptions
+)
+    : plane{ plane }
+    , vlm{ plane, false }
+    , dt{ dt }
+    , nThreads{ nThreads }
+{
+    if (dt <= 0) {
+        throw std::invalid_argument("Unsteady: time step must be positive.");
+    }
+
+    vlm.setFreestream(Qinf, alpha, beta, atmosphereDensity);
+    vlm.setThreads(nThreads);
+
+    // Bound lattice with the trailing edge rings closed one wake row
+    // downstream - the row shed at the end of the step.
+    std::array<double, 3> step{
+        vlm.Qinf_vec[0] * dt, vlm.Qinf_vec[1] * dt, vlm.Qinf_vec[2] * dt };
+    std::vector<std::vector<double>> trailingEdges;
+    lattice = vlm.ringLattice(step.data(), &trailingEdges);
+
+    const int N{ plane->mesh->nPanels };
+    std::vector<double> a((size_t)N * N);
+    nc::NdArray<double> RHS = nc::zeros<double>(N, 1);
+    vlm.b = nc::zeros<double>(N, N);
+
+    vlm.assemble(lattice, a, RHS);
+    vlm.lu = utils::LU{ std::move(a), N };
+
+    wakeOptions.dt = dt;
+    wakeOptions.nThreads = nThreads;
+    wake = std::make_unique<Wake>(trailingEdges, step, vlm.R, wakeOptions);
+    if (wakeOptions.particles) {
+        wake->setBoundLattice(lattice.segments);
+        gammaBound.resize(lattice.segments.size());
+    }
+
+    cps.resize(3 * (size_t)N);
+    normals.resize(3 * (size_t)N);
+    dy.resize(N);
+    area.resize(N);
+    int k{ 0 };
+    for (Panel& p : *plane->mesh)
+    {
+        for (int d{ 0 }; d != 3; d++) {
+            cps[3 * k + d] = p.cp[d];
+            normals[3 * k + d] = p.normal[d];
+        }
+        dy[k] = p.dy;
+        area[k] = p.area;
+        k++;
+    }
+
+    // Trailing edge ring of each wake column, wing by wing.
+    int offset{ 0 };
+    for (int w{ 0 }; w != plane->n_wings; w++)
+    {
+        const Wing& wing{ *plane->wings[w] };
+        for (int j{ 0 }; j != wing.m_sum; j++) {
+            trailingEdgeRings.push_back(offset + j + wing.m_sum * (wing.n - 1));
+        }
+        offset += wing.n * wing.m_sum;
+    }
+
+    geometryHash = utils::fnv1a(cps);
+    geometryHash = utils::fnv1a(normals, geometryHash);
+    geometryHash = utils::fnv1a(area, geometryHash);
+    geometryHash = utils::fnv1a(step.data(), sizeof(step), geometryHash);
+
+    gammaPrev.assign(N, 0);
+    wash.resize(N);
+    downwash.resize(N);
+    gammaShed.resize(trailingEdgeRings.size());
+    vlm.vorticity = nc::zeros<double>(N, 1);
+}
+
+void Unsteady::advance(const Vlm::OnsetFunction& onset)
+{
+    const int N{ plane->mesh->nPanels };
+    const double rho{ vlm.rho };
+    const double Qinf{ vlm.Qinf };
+
+    if (onset) { onset(stepCount, onsetField); }
+    else if ((int)onsetField.shape().rows != N) { onsetField = vlm.freestreamOnset(); }
+
+    wake->normalWash(cps, normals, wash.data(), downwash.data(), nThreads);
+
+    nc::NdArray<double>& gamma{ vlm.vorticity };
+    for (int i{ 0 }; i != N; i++)
+    {
+        const double* n{ &normals[3 * i] };
+        gamma[i] = -(
+            onsetField(i, 0) * n[0] + onsetField(i, 1) * n[1] + onsetField(i, 2) * n[2]
+        ) - wash[i];
+    }
+    vlm.lu.solve(gamma.data());
+
+    // Downwash of the lattice chordwise edges, plus the wake's below.
+    nc::NdArray<double> w_ind{ nc::matmul(vlm.b, gamma) };
+
+    const double cos_a{ std::cos(vlm.alpha_rad) };
+    const double sin_a{ std::sin(vlm.alpha_rad) };
+
+    double L{ 0 };
+    double Di{ 0 };
+    int k{ 0 };
+    for (Panel& p : *plane->mesh)
+    {
+        double dG{ gamma[k] };
+        if (vlm.upstream[k] >= 0) { dG -= gamma[vlm.upstream[k]]; }
+
+        double dGdt{ (gamma[k] - gammaPrev[k]) / dt };
+        double w{ w_ind[k] + downwash[k] };
+
+        p.vorticity = dG;
+        p.w_ind = w;
+        p.dL = rho * (Qinf * dG * dy[k] + dGdt * area[k] * cos_a);
+        p.dDi = rho * (-w * dG * dy[k] + dGdt * area[k] * sin_a);
+
+        L += p.dL;
+        Di += p.dDi;
+
+        gammaPrev[k] = gamma[k];
+        k++;
+    }
+
+    const double q_S{ 0.5 * rho * plane->S_ref * std::pow(Qinf, 2) };
+    CL = L / q_S;
+    CDi = Di / q_S;
+    vlm.CL = CL;
+    vlm.CDi = CDi;
+
+    for (int j{ 0 }; j != (int)trailingEdgeRings.size(); j++) {
+        gammaShed[j] = gamma[trailingEdgeRings[j]];
+    }
+
+    // Column N is no ring.
+    for (int s{ 0 }; s != (int)gammaBound.size(); s++) {
+        const std::array<int, 2>& c{ lattice.columns[s] };
+        gammaBound[s] = (c[0] < N ? lattice.signs[s][0] * gamma[c[0]] : 0)
+            + (c[1] < N ? lattice.signs[s][1] * gamma[c[1]] : 0);
+    }
+    wake->shed(gammaShed.data(), gammaBound.empty() ? nullptr : gammaBound.data());
+
+    stepCount++;
+}
+
+namespace
+{
+    const char checkpointMagic[8]{ 'V', 'L', 'M', 'C', 'K', 'P', 'T', 1 };
+}
+
+/// <summary>
+/// Layout: magic/version, geometry hash, step, CL, CDi, gamma at the last
+/// step, then the wake (Wake::write). Native byte order.
+/// </summary>
+std::vector<char> Unsteady::checkpoint() const
+{
+    utils::ByteWriter out;
+    out.buffer.reserve(wake->memoryUse() + 16 * gammaPrev.size() + 1024);
+
+    out.putBytes(checkpointMagic, sizeof(checkpointMagic));
+    out.put(geometryHash);
+    out.put(stepCount);
+    out.put(CL);
+    out.put(CDi);
+    out.put(gammaPrev);
+    wake->write(out);
+
+    return std::move(out.buffer);
+}
+
+void Unsteady::restart(const std::vector<char>& bytes)
+{
+    utils::ByteReader in{ bytes };
+
+    char magic[sizeof(checkpointMagic)];
+    in.getBytes(magic, sizeof(magic));
+    if (std::memcmp(magic, checkpointMagic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not an unsteady checkpoint (or an old version).");
+    }
+    if (in.get<std::uint64_t>() != geometryHash) {
+        throw std::runtime_error(
+            "Checkpoint was written for a different geometry, freestream or time step.");
+    }
+
+    stepCount = in.get<int>();
+    CL = in.get<double>();
+    CDi = in.get<double>();
+
+    std::vector<double> gamma{ in.getVector<double>() };
+    if (gamma.size() != gammaPrev.size()) {
+        throw std::runtime_error("Checkpoint is corrupt.");
+    }
+    gammaPrev = gamma;
+    std::copy(gamma.begin(), gamma.end(), vlm.vorticity.data());
+    vlm.CL = CL;
+    vlm.CDi = CDi;
+
+    wake->read(in);
+}
+
+Unsteady::History Unsteady::run(int nSteps, const Vlm::OnsetFunction& onset)
+{
+    History history;
+    history.t.reserve(nSteps);
+    history.CL.reserve(nSteps);
+    history.CDi.reserve(nSteps);
+
+    for (int i{ 0 }; i != nSteps; i++)
+    {
+        double t{ getTime() };
+        advance(onset);
+
+        history.t.push_back(t);
+        history.CL.push_back(CL);
+        history.CDi.push_back(CDi);
+    }
+
+    return history;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <pch.h>
+
+#include <plane.hpp>
+#include <vlm.hpp>
+#include <wake.hpp>
+#include <utils/checkpoint.hpp>
+
+/// <summary>
+/// Unsteady vortex ring lattice (Katz & Plotkin, 13.12). Every time step the
+/// trailing edge rings shed a wake row. The bound lattice is rigid in the
+/// body frame, so its influence matrix is assembled and factorised once;
+/// each step only evaluates the wake normal-wash on the collocation points
+/// and back-substitutes. Motion and gusts enter through the onset velocity
+/// at the collocation points (see Onset), so the wake is convected with the
+/// freestream and stays flat in the body frame.
+///
+/// Loads per panel:
+///     dL = rho (Qinf dG dy + dGamma/dt A cos(alpha))
+///     dDi = rho (-w_ind dG dy + dGamma/dt A sin(alpha))
+/// where dG is the bound vortex strength (ring minus the ring ahead) and
+/// w_ind the downwash of the chordwise lattice edges and wake.
+/// </summary>
+class Unsteady {
+public:
+    struct History {
+        std::vector<double> t;
+        std::vector<double> CL;
+        std::vector<double> CDi;
+    };
+
+private:
+    Plane* plane;
+    Vlm vlm;
+    double dt;
+    int nThreads;
+    std::unique_ptr<Wake> wake;
+
+    // Panel data as flat arrays.
+    std::vector<double> cps;
+    std::vector<double> normals;
+    std::vector<double> dy;
+    std::vector<double> area;
+    std::vector<int> trailingEdgeRings;
+
+    std::vector<double> gammaPrev;
+    std::vector<double> wash;
+    std::vector<double> downwash;
+    std::vector<double> gammaShed;
+    nc::NdArray<double> onsetField;
+
+    // Bound lattice segment strengths, which convect a particle wake.
+    Vlm::Lattice lattice;
+    std::vector<double> gammaBound;
+    int stepCount{ 0 };
+    std::uint64_t geometryHash{ 0 };    // panels, time step and freestream
+
+public:
+    double CL{ 0 };
+    double CDi{ 0 };
+
+    /// <param name="dt">Time step. Wake rows are Qinf dt long.</param>
+    /// <param name="wakeOptions">Wake memory budget and model, see Wake.
+    /// The particle time step is set to dt.</param>
+    Unsteady(
+        Plane* plane, double Qinf, double alpha, double beta, double atmosphereDensity,
+        double dt, int nThreads, Wake::Options wakeOptions
+    );
+    Unsteady(
+        Plane* plane, double Qinf, double alpha, double beta, double atmosphereDensity,
+        double dt, int nThreads = 0
+    ) : Unsteady(plane, Qinf, alpha, beta, atmosphereDensity, dt, nThreads, Wake::Options{}) {}
+
+    // Solves the current step and sheds its wake row. Without an onset
+    // function the onset is the freestream.
+    void advance(const Vlm::OnsetFunction& onset = nullptr);
+    History run(int nSteps, const Vlm::OnsetFunction& onset = nullptr);
+
+    // Binary snapshot of the time-marching state: step, circulation and
+    // wake. The factorisation is not stored but referenced by geometryHash,
+    // which restart checks against this solver's (the constructor has
+    // already factorised the same system).
+    std::vector<char> checkpoint() const;
+    void restart(const std::vector<char>& bytes);
+    void restart(const std::string& path) { restart(utils::readFile(path)); }
+
+    int getStep() const { return stepCount; }
+    double getTime() const { return stepCount * dt; }
+    double getDt() const { return dt; }
+    const Vlm& getVlm() const { return vlm; }
+    const Wake& getWake() const { return *wake; }
+    std::uint64_t getGeometryHash() const { return geometryHash; }
+
+};
@@ -0,0 +1,123 @@
+#include <pch.h>
+
+#include <unsteadyrun.hpp>
+#include <onset.hpp>
+
+using json = nlohmann::json;
+
+UnsteadyRun::UnsteadyRun(std::ifstream& spec)
+{
+    read_spec(spec);
+}
+
+/// <summary>
+/// Reads the run spec and the plane, sets up the motion and restores the
+/// restart snapshot if any. See unsteadyrun.hpp for layout.
+/// </summary>
+/// <param name="file"> {std::ifstream}: Input .json filestream.</param>
+void UnsteadyRun::read_spec(std::ifstream& file)
+{
+    json j_spec = json::parse(file);
+    file.close();
+
+    std::string plane_file = j_spec["plane"];
+    std::ifstream f{ plane_file };
+    if (f.fail()) {
+        throw std::runtime_error("Plane file not found: " + plane_file);
+    }
+    plane = std::make_unique<Plane>(f);
+
+    double Qinf = j_spec.value("Qinf", 1.0);
+    double dt = j_spec.value("dt", plane->c_ref / (4 * Qinf));
+    steps = j_spec.value("steps", steps);
+
+    Wake::Options wake;
+    wake.memoryBudget = (std::size_t)(j_spec.value("wake_memory_mb", 0.0) * 1024 * 1024);
+    wake.particles = j_spec.value("wake", "rings") == "particles";
+    wake.redistributeEvery = j_spec.value("redistribute_every", 0);
+    wake.cellSize = j_spec.value("cell_size", 0.0);
+
+    unsteady = std::make_unique<Unsteady>(
+        plane.get(), Qinf, j_spec.value("alpha", 0.0), j_spec.value("beta", 0.0),
+        j_spec.value("rho", 1.225), dt, j_spec.value("threads", 0), wake
+    );
+
+    if (j_spec.contains("motion"))
+    {
+        const json& motion = j_spec["motion"];
+        std::string type = motion["type"];
+        double amplitude = motion.value("amplitude", 0.0);
+
+        if (type == "heave") {
+            onset = Onset::heave(unsteady->getVlm(), amplitude, motion.value("frequency", 1.0), dt);
+        }
+        else if (type == "pitch") {
+            std::array<double, 3> pivot = motion.value("pivot", std::array<double, 3>{ 0, 0, 0 });
+            onset = Onset::pitch(
+                unsteady->getVlm(), amplitude, motion.value("frequency", 1.0), dt, pivot);
+        }
+        else if (type == "gust") {
+            onset = Onset::gust(
+                unsteady->getVlm(), amplitude, motion.value("length", 1.0), dt,
+                motion.value("x0", 0.0));
+        }
+        else {
+            throw std::invalid_argument("Unknown motion: " + type);
+        }
+    }
+
+    checkpoint = j_spec.value("checkpoint", "");
+    checkpointEvery = j_spec.value("checkpoint_every", 0);
+
+    std::string restart = j_spec.value("restart", "");
+    if (!restart.empty())
+    {
+        try {
+            unsteady->restart(restart);
+        }
+        catch (const std::exception& e) {
+            throw std::runtime_error(std::string{ "Restart failed: " } + e.what());
+        }
+        restarted = true;
+    }
+}
+
+/// <summary>
+/// Advances to the last step, writing a record per step. Checkpoints are
+/// only taken when the writer is free, so the loop never waits on disk.
+/// </summary>
+void UnsteadyRun::run(std::ostream& out)
+{
+    utils::AsyncFileWriter checkpoints;
+
+    for (int i{ unsteady->getStep() }; i < steps; i++)
+    {
+        json record;
+        record["step"] = i;
+        record["t"] = unsteady->getTime();
+
+        unsteady->advance(onset);
+
+        record["CL"] = unsteady->CL;
+        record["CDi"] = unsteady->CDi;
+        record["wake_rows"] = unsteady->getWake().rows();
+        record["wake_particles"] = unsteady->getWake().particles();
+
+        if (!checkpoint.empty() && checkpointEvery > 0 && (i + 1) % checkpointEvery == 0)
+        {
+            bool written{ false };
+            if (!checkpoints.busy())
+            {
+                char name[32];
+                std::snprintf(name, sizeof(name), "_%06d.ckpt", i + 1);
+                written = checkpoints.tryWrite(checkpoint + name, unsteady->checkpoint());
+            }
+            record["checkpoint"] = written;
+        }
+        out << record.dump() << '\n';
+    }
+
+    checkpoints.wait();
+    std::string error{ checkpoints.lastError() };
+    if (!error.empty()) { std::cout << "Checkpoint failed: " << error << '\n'; }
+}
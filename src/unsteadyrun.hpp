@@ -0,0 +1,51 @@
+#pragma once
+
+#include <pch.h>
+
+#include <plane.hpp>
+#include <unsteady.hpp>
+
+/// <summary>
+/// Unsteady time history of one plane (see Unsteady), with optional motion,
+/// background checkpoints and restart.
+///
+/// Spec layout:
+/// {
+///     "plane": "wing.json", "Qinf": 1, "alpha": 5, "beta": 0, "rho": 1.225,
+///     "dt": 0.05, "steps": 1000, "threads": 8, "wake_memory_mb": 64,
+///     "wake": "particles", "redistribute_every": 10,
+///     "checkpoint": "run", "checkpoint_every": 100, "restart": "run_000500.ckpt",
+///     "motion": { "type": "heave", "amplitude": 0.1, "frequency": 1 }
+/// }
+/// motion (optional): heave | pitch (+ "pivot") | gust ("amplitude",
+/// "length", "x0"). dt defaults to c_ref / (4 Qinf). wake_memory_mb bounds
+/// the wake (old rows are lumped into particles); 0 or absent keeps all rows
+/// (particle wake: 16 rows' worth of particles). wake: rings (default,
+/// rigid) | particles (free vortex particles convected by the wake and wing,
+/// with optional redistribution onto a "cell_size" grid). Every
+/// checkpoint_every steps a snapshot is written to <checkpoint>_<step>.ckpt
+/// in the background (skipped if the last one is still writing). restart
+/// resumes from a snapshot. One JSON line is written per step.
+/// </summary>
+class UnsteadyRun {
+private:
+    std::unique_ptr<Plane> plane;
+    std::unique_ptr<Unsteady> unsteady;
+    Vlm::OnsetFunction onset;
+
+    int steps{ 100 };
+    std::string checkpoint;
+    int checkpointEvery{ 0 };
+    bool restarted{ false };
+
+    void read_spec(std::ifstream& file);
+
+public:
+    UnsteadyRun(std::ifstream& spec);
+
+    // Resumed from a checkpoint, so history should be appended.
+    bool isRestart() const { return restarted; }
+
+    void run(std::ostream& out);
+
+};
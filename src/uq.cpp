@@ -0,0 +1,234 @@
+#include <pch.h>
+
+#include <uq.hpp>
+#include <vlm.hpp>
+
+using json = nlohmann::json;
+
+double Distribution::sample(std::mt19937_64& rng) const
+{
+    switch (type)
+    {
+    case Type::uniform:
+        return std::uniform_real_distribution<double>{ a, b }(rng);
+    case Type::normal:
+    default:
+        return b > 0 ? std::normal_distribution<double>{ a, b }(rng) : a;
+    }
+}
+
+MonteCarlo::MonteCarlo(std::ifstream& spec)
+{
+    read_spec(spec);
+}
+
+/// <summary>
+/// Reads UQ spec and the nominal plane. See uq.hpp for layout.
+/// </summary>
+/// <param name="file"> {std::ifstream}: Input .json filestream.</param>
+void MonteCarlo::read_spec(std::ifstream& file)
+{
+    json j_spec = json::parse(file);
+    file.close();
+
+    std::string plane_file = j_spec["plane"];
+    std::ifstream f{ plane_file };
+    if (f.fail()) {
+        throw std::runtime_error("Plane file not found: " + plane_file);
+    }
+    nominal = std::make_unique<Plane>(f);
+
+    int hardware_threads{ (int)std::thread::hardware_concurrency() };
+    nSamples = j_spec.value("samples", nSamples);
+    nThreads = std::max(j_spec.value("threads", std::max(hardware_threads, 1)), 1);
+    reportEvery = std::max(j_spec.value("report_every", reportEvery), 1);
+    seed = j_spec.value("seed", seed);
+    probabilities = j_spec.value("quantiles", probabilities);
+
+    Qinf = j_spec.value("Qinf", Qinf);
+    alpha = j_spec.value("alpha", alpha);
+    beta = j_spec.value("beta", beta);
+    rho = j_spec.value("rho", rho);
+
+    for (auto& j_p : j_spec["perturbations"]) {
+        Perturbation p;
+
+        p.wing = j_p.value("wing", 0);
+        p.section = j_p.value("section", -1);
+
+        if (p.wing < 0 || p.wing >= nominal->n_wings ||
+            p.section >= nominal->wings[p.wing]->n_sections)
+        {
+            throw std::invalid_argument(
+                "Perturbation references a wing/section not in " + plane_file);
+        }
+
+        std::string parameter = j_p["parameter"];
+        if (parameter == "chord") { p.parameter = Perturbation::Parameter::chord; }
+        else if (parameter == "incident") { p.parameter = Perturbation::Parameter::incident; }
+        else if (parameter == "le_x") { p.parameter = Perturbation::Parameter::le_x; }
+        else if (parameter == "le_y") { p.parameter = Perturbation::Parameter::le_y; }
+        else if (parameter == "le_z") { p.parameter = Perturbation::Parameter::le_z; }
+        else {
+            throw std::invalid_argument("Unknown perturbation parameter: " + parameter);
+        }
+
+        std::string distribution = j_p.value("distribution", "normal");
+        if (distribution == "normal") {
+            p.distribution.type = Distribution::Type::normal;
+            p.distribution.a = j_p.value("mean", 0.0);
+            p.distribution.b = j_p.value("sigma", 0.0);
+        }
+        else if (distribution == "uniform") {
+            p.distribution.type = Distribution::Type::uniform;
+            p.distribution.a = j_p.value("min", 0.0);
+            p.distribution.b = j_p.value("max", 0.0);
+        }
+        else {
+            throw std::invalid_argument("Unknown distribution: " + distribution);
+        }
+
+        perturbations.push_back(p);
+    }
+
+    CL_stats = utils::RunningStats{ probabilities };
+    CDi_stats = utils::RunningStats{ probabilities };
+}
+
+/// <summary>
+/// Builds a perturbed copy of the nominal plane. The random stream is seeded
+/// per sample so results do not depend on thread scheduling.
+/// </summary>
+std::unique_ptr<Plane> MonteCarlo::samplePlane(int index) const
+{
+    std::seed_seq seq{ seed, (unsigned long long)index };
+    std::mt19937_64 rng{ seq };
+
+    std::vector<std::unique_ptr<Wing>> wings{ nominal->copyWings() };
+
+    for (const Perturbation& p : perturbations)
+    {
+        std::vector<Section>& sections{ wings[p.wing]->sections };
+
+        int first{ p.section == -1 ? 0 : p.section };
+        int last{ p.section == -1 ? (int)sections.size() : p.section + 1 };
+
+        for (int i{ first }; i != last; i++)
+        {
+            Section& section{ sections[i] };
+            double delta{ p.distribution.sample(rng) };
+
+            switch (p.parameter)
+            {
+            case Perturbation::Parameter::chord: section.chord += delta; break;
+            case Perturbation::Parameter::incident: section.incident += delta; break;
+            case Perturbation::Parameter::le_x: section.leading_edge[0] += delta; break;
+            case Perturbation::Parameter::le_y: section.leading_edge[1] += delta; break;
+            case Perturbation::Parameter::le_z: section.leading_edge[2] += delta; break;
+            }
+        }
+    }
+
+    return std::make_unique<Plane>(std::move(wings), 1);
+}
+
+/// <summary>
+/// Solves nominal plane then all samples on a worker pool. A JSON line of
+/// running statistics is written every reportEvery samples and at the end.
+/// </summary>
+void MonteCarlo::run(std::ostream& out)
+{
+    Vlm nominalVlm{ nominal.get(), false };
+    nominalVlm.setThreads(nThreads);
+    nominalVlm.runHorseshoe(Qinf, alpha, beta, rho);
+
+    auto start{ std::chrono::high_resolution_clock::now() };
+    auto elapsed = [&]() {
+        std::chrono::duration<double> dt{ std::chrono::high_resolution_clock::now() - start };
+        return dt.count();
+    };
+
+    std::atomic<int> next{ 0 };
+    auto worker = [&]() {
+        for (int i{ next++ }; i < nSamples; i = next++)
+        {
+            bool ok{ true };
+            bool warm{ false };
+            double CL{ 0 };
+            double CDi{ 0 };
+            try {
+                std::unique_ptr<Plane> plane{ samplePlane(i) };
+
+                Vlm vlm{ plane.get(), false };
+                vlm.setThreads(1);      // one per worker
+                vlm.runHorseshoe(Qinf, alpha, beta, rho, &nominalVlm);
+
+                CL = vlm.CL;
+                CDi = vlm.CDi;
+                warm = vlm.refineIterations >= 0;
+            }
+            catch (const std::exception&) {
+                ok = false;
+            }
+
+            std::lock_guard<std::mutex> lock{ statsMutex };
+            nDone++;
+            if (ok) {
+                CL_stats.add(CL);
+                CDi_stats.add(CDi);
+                if (warm) { nWarm++; }
+            }
+            else {
+                nFailed++;
+            }
+
+            if (nDone % reportEvery == 0 && nDone != nSamples) {
+                report(out, elapsed());
+            }
+        }
+    };
+
+    int n_workers{ std::min(nThreads, std::max(nSamples, 1)) };
+
+    std::vector<std::thread> workers;
+    for (int i{ 0 }; i != n_workers; i++) {
+        workers.emplace_back(worker);
+    }
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    report(out, elapsed());
+}
+
+/// <summary>
+/// Writes current statistics as one JSON line. Caller holds statsMutex.
+/// </summary>
+void MonteCarlo::report(std::ostream& out, double elapsed_s)
+{
+    auto stats_json = [](const utils::RunningStats& stats) {
+        json j;
+        j["mean"] = stats.mean();
+        j["variance"] = stats.variance();
+        j["std"] = stats.stddev();
+        j["min"] = stats.min();
+        j["max"] = stats.max();
+        for (const utils::P2Quantile& q : stats.quantiles()) {
+            std::ostringstream key;
+            key << 'q' << q.probability();
+            j[key.str()] = q.value();
+        }
+        return j;
+    };
+
+    json record;
+    record["samples"] = nDone;
+    record["failed"] = nFailed;
+    record["warm_started"] = nWarm;
+    record["elapsed_s"] = elapsed_s;
+    record["samples_per_s"] = elapsed_s > 0 ? nDone / elapsed_s : 0;
+    record["CL"] = stats_json(CL_stats);
+    record["CDi"] = stats_json(CDi_stats);
+
+    out << record.dump() << std::endl;
+}
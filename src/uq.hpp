@@ -0,0 +1,92 @@
+#pragma once
+
+#include <pch.h>
+
+#include <plane.hpp>
+#include <utils/statistics.hpp>
+
+/// <summary>
+/// Random distribution of a geometry tolerance.
+///     normal: a = mean, b = standard deviation
+///     uniform: a = min, b = max
+/// </summary>
+struct Distribution {
+    enum class Type { normal, uniform };
+
+    Type type{ Type::normal };
+    double a{ 0 };
+    double b{ 0 };
+
+    double sample(std::mt19937_64& rng) const;
+};
+
+/// <summary>
+/// Additive perturbation of one section parameter. section = -1 applies an
+/// independent sample to every section of the wing.
+/// </summary>
+struct Perturbation {
+    enum class Parameter { chord, incident, le_x, le_y, le_z };
+
+    int wing{ 0 };
+    int section{ -1 };
+    Parameter parameter{ Parameter::chord };
+    Distribution distribution;
+};
+
+/// <summary>
+/// Monte Carlo propagation of section tolerances (chord, incidence, leading
+/// edge) to CL/CDi. Samples are meshed and solved on a worker pool and only
+/// running statistics are kept, so memory does not grow with sample count.
+/// Each sample is warm-started from the nominal solution (see
+/// Vlm::runHorseshoe).
+///
+/// Spec layout:
+/// {
+///     "plane": "wing.json", "samples": 1000, "threads": 8, "seed": 1,
+///     "report_every": 100, "quantiles": [0.05, 0.5, 0.95],
+///     "Qinf": 1, "alpha": 5, "beta": 0, "rho": 1.225,
+///     "perturbations": [
+///         { "wing": 0, "section": 1, "parameter": "chord",
+///           "distribution": "normal", "mean": 0, "sigma": 0.005 },
+///         { "wing": 0, "parameter": "incident",
+///           "distribution": "uniform", "min": -0.2, "max": 0.2 }
+///     ]
+/// }
+/// parameter: chord | incident | le_x | le_y | le_z
+/// </summary>
+class MonteCarlo {
+private:
+    std::unique_ptr<Plane> nominal;
+    std::vector<Perturbation> perturbations;
+
+    int nSamples{ 1000 };
+    int nThreads{ 1 };
+    int reportEvery{ 100 };
+    unsigned long long seed{ 1 };
+    std::vector<double> probabilities{ 0.05, 0.5, 0.95 };
+
+    double Qinf{ 1 };
+    double alpha{ 0 };
+    double beta{ 0 };
+    double rho{ 1.225 };
+
+    std::mutex statsMutex;
+    utils::RunningStats CL_stats;
+    utils::RunningStats CDi_stats;
+    int nDone{ 0 };
+    int nWarm{ 0 };
+    int nFailed{ 0 };
+
+    void read_spec(std::ifstream& file);
+    std::unique_ptr<Plane> samplePlane(int index) const;
+    void report(std::ostream& out, double elapsed_s);
+
+public:
+    MonteCarlo(std::ifstream& spec);
+
+    void run(std::ostream& out);
+
+    const utils::RunningStats& getCL() const { return CL_stats; }
+    const utils::RunningStats& getCDi() const { return CDi_stats; }
+
+};
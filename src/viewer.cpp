@@ -312,7 +312,7 @@ void Viewer::drawL()
 {
 	for (Panel& p : *mesh)
 	{
-		std::array<nc::NdArray<double>,4> corners = p.getCorners();
+		std::array<const double*, 4> corners{ p.getCorners() };
 		Vector3 P1_{ 
 			(float)corners[0][0], (float)corners[0][1], (float)corners[0][2] };
 		Vector3 P2_{ 
@@ -349,7 +349,7 @@ void Viewer::drawD()
 {
 	for (Panel& p : *mesh)
 	{
-		std::array<nc::NdArray<double>, 4> corners = p.getCorners();
+		std::array<const double*, 4> corners{ p.getCorners() };
 		Vector3 P1_{
 			(float)corners[0][0], (float)corners[0][1], (float)corners[0][2] };
 		Vector3 P2_{
@@ -386,7 +386,7 @@ void Viewer::drawWind()
 {
 	for (Panel& p : *mesh)
 	{
-		std::array<nc::NdArray<double>, 4> corners = p.getCorners();
+		std::array<const double*, 4> corners{ p.getCorners() };
 		Vector3 P1_{
 			(float)corners[0][0], (float)corners[0][1], (float)corners[0][2] };
 		Vector3 P2_{
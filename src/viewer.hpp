@@ -59,7 +59,7 @@ public:
 	Viewer(Vlm* vlm, bool showCp = true, bool showNormals = false)
 		: running{ true }
 		, vlm { vlm }
-		, mesh{ vlm->getPlane()->mesh}
+		, mesh{ vlm->getPlane()->mesh.get() }
 		, showCp{ showCp }
 		, showNormals{ showNormals }
 		, meshLines{ mesh->getRlLines() }
@@ -4,35 +4,155 @@
 
 #include <mesh.hpp>
 #include <plane.hpp>
+#include <utils/linalg.hpp>
+#include <utils/parallel.hpp>
+#include <utils/vortex.hpp>
+
+class SolveCache;
 
 class Vlm
 {
+	friend class Unsteady;	// reuse the ring lattice and its factorisation
+	friend class FreeWake;	// "
+
 private:
 	Plane* plane;
 	double R{ 1e-10 };
 	double rho{ 0 };
 	double Qinf{ 0 };
+	bool verbose;
+	double alpha_rad{ 0 };
+	double beta_rad{ 0 };
+	nc::NdArray<double> Qinf_vec;
+
+	nc::NdArray<double> b;			// wake induced downwash influence
+	nc::NdArray<double> vorticity;	// solved vortex strengths (N x 1)
+	utils::LU lu;					// factorised influence matrix
+	SolveCache* solveCache{ nullptr };
+	int nThreads{ 0 };				// assembly and matrix products (0: all cores)
 
-	std::array<double, 3> lineVortex(
-		double x, double y, double z, double x1, double y1, double z1,
-		double x2, double y2, double z2, double vorticity, double R
+	int maxRefineIterations{ 20 };
+	double refineTolerance{ 1e-10 };
+	int maxGmresIterations{ 300 };
+	double gmresTolerance{ 1e-8 };
+
+	// Unique vortex segments of a lattice and the (up to two) vortex
+	// strengths each one carries, with sign. Unused slots use column N.
+	struct Lattice {
+		utils::Segments segments;
+		std::vector<std::array<int, 2>> columns;
+		std::vector<std::array<double, 2>> signs;
+		std::vector<char> trailing;	// counts towards wake downwash (b)
+		std::vector<int> legs;		// semi-infinite wake legs (ring lattice)
+	};
+	std::vector<int> upstream;		// ring ahead of each panel (ring lattice)
+
+	Lattice horseshoeLattice() const;
+	Lattice ringLattice(
+		const double* wakeStep = nullptr,
+		std::vector<std::vector<double>>* trailingEdges = nullptr
+	);
+	std::uint64_t influenceKey(const Lattice& lattice) const;
+	void assemble(const Lattice& lattice, std::vector<double>& a, nc::NdArray<double>& RHS);
+	void solve(
+		const Lattice& lattice, const Vlm* warmStart,
+		const nc::NdArray<double>* initialGuess = nullptr
 	);
 
-	std::array<std::array<double, 3>, 2> horseshoeVortex(
-		double x, double y, double z, double xA, double yA, double zA,
-		double xB, double yB, double zB, double xC, double yC, double zC,
-		double xD, double yD, double zD, double vorticity, double R
+	void setFreestream(double Qinf, double alpha, double beta, double atmosphereDensity);
+	bool refine(
+		const std::vector<double>& a, const nc::NdArray<double>& RHS,
+		const Vlm& warmStart
 	);
+	bool iterate(
+		const std::vector<double>& a, const nc::NdArray<double>& RHS,
+		const nc::NdArray<double>& initialGuess
+	);
+	void calcLoads();
+	void buildStrips();
 
 public:
 	double CL{ 0 };
 	double CDi{ 0 };
+	int refineIterations{ -1 };	// -1 if last solve was direct, else iterations
+	bool solveCached{ false };		// last solve used factors from the solve cache
+
+	// Fills onset (N x 3) with the onset velocity at each collocation point
+	// for a given time step.
+	using OnsetFunction = std::function<void(int step, nc::NdArray<double>& onset)>;
+
+	// Spanwise strip of panels used by the viscous correction.
+	struct Strip {
+		std::vector<int> panels;	// global panel indices, leading edge first
+		double chord{ 0 };
+		double dy{ 0 };
+		std::array<const Polar*, 2> polars{ nullptr, nullptr };	// inboard, outboard section
+		std::array<double, 2> weights{ 0, 0 };	// polar blend
+		double dalpha{ 0 };			// alpha correction (rad)
+		double alpha_eff{ 0 };		// effective section angle (deg)
+		double cl{ 0 };				// viscous section lift
+		double cd{ 0 };				// section profile drag
+		bool stalled{ false };
+	};
+
+	std::vector<Strip> strips;
+	double CDv{ 0 };				// profile drag from section polars
+	int viscousIterations{ 0 };
+	bool viscousConverged{ false };
+
+	// Force coefficient time histories.
+	struct LoadHistory {
+		std::vector<double> CL;
+		std::vector<double> CDi;
+	};
 
-	Vlm(Plane* plane);
+	Vlm(Plane* plane, bool verbose = true);
 
-	void runHorseshoe(double Qinf, double alpha, double beta, double atmosphereDensity);
-	void runRing();
+	// Direct solves look up and store factorised influence matrices in
+	// cache (none if nullptr). The cache must outlive the solves.
+	void setSolveCache(SolveCache* cache) { solveCache = cache; }
+
+	// Worker threads for assembly and matrix products (0: all cores). Solves
+	// run from a worker pool must pass their share of the cores (1 per
+	// worker), else every concurrent solve spreads over all cores.
+	void setThreads(int threads) { nThreads = threads; }
+
+	void runHorseshoe(
+		double Qinf, double alpha, double beta, double atmosphereDensity,
+		const Vlm* warmStart = nullptr
+	);
+	void runRing(
+		double Qinf, double alpha, double beta, double atmosphereDensity,
+		const Vlm* warmStart = nullptr
+	);
+
+	// GMRES solve from an initial guess of the vortex strengths (N x 1),
+	// e.g. a coarser solution interpolated onto this mesh. No factorisation
+	// is kept, so RHS-only solves are not available afterwards.
+	void runHorseshoe(
+		double Qinf, double alpha, double beta, double atmosphereDensity,
+		const nc::NdArray<double>& initialGuess
+	);
+
+	void runViscous(
+		double Qinf, double alpha, double beta, double atmosphereDensity,
+		int maxIterations = 100, double tolerance = 1e-4, double relaxation = 0.5
+	);
+
+	// RHS-only solves against the factorisation of the last solve.
+	void runOnset(const nc::NdArray<double>& onset);
+	LoadHistory runOnset(const std::vector<nc::NdArray<double>>& onsets);
+	LoadHistory runOnset(int nSteps, const OnsetFunction& onset, int blockSize = 64);
+
+	// Freestream velocity at every collocation point (N x 3).
+	nc::NdArray<double> freestreamOnset() const;
+	nc::NdArray<double> collocationPoints() const;
+	const nc::NdArray<double>& getFreestream() const { return Qinf_vec; }
+	double getQinf() const { return Qinf; }
 
 	const Plane* getPlane() { return plane; }
 
+	// Estimated peak heap use of a horseshoe solve (bytes).
+	static std::size_t memoryEstimate(int nPanels);
+
 };
\ No newline at end of file
@@ -0,0 +1,526 @@
+#include <pch.h>
+
+#include <wake.hpp>
+#include <utils/parallel.hpp>
+
+Wake::Wake(
+    const std::vector<std::vector<double>>& trailingEdges,
+    std::array<double, 3> step, double R, Options options
+)
+    : options{ options }
+    , step{ step }
+    , R{ R }
+{
+    for (const std::vector<double>& te : trailingEdges)
+    {
+        int n_nodes{ (int)te.size() / 3 };
+
+        nodeOffsets.push_back(nodesPerLine);
+        ringOffsets.push_back(ringsPerRow);
+        nodesPerLine += n_nodes;
+        ringsPerRow += n_nodes - 1;
+
+        // Rows are shed from where the trailing edge rings close.
+        for (int j{ 0 }; j != n_nodes; j++) {
+            for (int k{ 0 }; k != 3; k++) {
+                attachLine.push_back(te[3 * j + k] + step[k]);
+            }
+        }
+    }
+
+    gammaLumped.assign(ringsPerRow, 0);
+
+    const std::size_t budget{ options.memoryBudget };
+    if (options.particles)
+    {
+        // One ring row at the trailing edge, the rest particles. Without a
+        // budget the pools hold as many rows as the default ring buffer
+        // starts with, so the O(P^2) particle kernel stays bounded too.
+        rowCapacity = 1;
+        maxParticles = budget == 0 ? defaultRows * (nodesPerLine + ringsPerRow) : std::max(
+            (int)(budget / 2 / (7 * sizeof(double))), 2 * (nodesPerLine + ringsPerRow));
+        bounded = true;
+
+        if (options.dt <= 0) {
+            throw std::invalid_argument("Wake: particle model needs a time step.");
+        }
+    }
+    else if (budget == 0) {
+        rowCapacity = defaultRows;
+    }
+    else
+    {
+        // Half the budget for near rows: line + strengths + segments (8
+        // doubles each, about one spanwise and one chordwise edge per node).
+        std::size_t row_bytes{ sizeof(double) * (
+            3 * (size_t)nodesPerLine + ringsPerRow + 8 * (size_t)(nodesPerLine + ringsPerRow)) };
+        rowCapacity = std::max((int)(budget / 2 / row_bytes), 2);
+
+        // Other half for the two particle pools (7 doubles each).
+        maxParticles = std::max(
+            (int)(budget / 4 / (7 * sizeof(double))), 2 * (nodesPerLine + ringsPerRow));
+        bounded = true;
+    }
+
+    lines.resize(3 * (size_t)nodesPerLine * (rowCapacity + 1));
+    gamma.resize((size_t)ringsPerRow * rowCapacity);
+}
+
+/// <summary>
+/// Doubles the ring buffers of an unbounded wake, oldest first.
+/// </summary>
+void Wake::grow()
+{
+    int capacity{ 2 * rowCapacity };
+
+    std::vector<double> new_lines(3 * (size_t)nodesPerLine * (capacity + 1));
+    std::vector<double> new_gamma((size_t)ringsPerRow * capacity);
+    for (int l{ 0 }; l != nLines; l++) {
+        std::copy(line(l), line(l) + 3 * nodesPerLine, &new_lines[3 * (size_t)nodesPerLine * l]);
+    }
+    for (int r{ 0 }; r != nRows; r++) {
+        std::copy(row(r), row(r) + ringsPerRow, &new_gamma[(size_t)ringsPerRow * r]);
+    }
+
+    lines.swap(new_lines);
+    gamma.swap(new_gamma);
+    rowCapacity = capacity;
+    lineHead = 0;
+    rowHead = 0;
+}
+
+void Wake::setBoundLattice(const utils::Segments& segments)
+{
+    bound = segments;
+    boundStrengths.assign(bound.size(), 0);
+}
+
+void Wake::shed(const double* gammaTrailingEdge, const double* gammaBound)
+{
+    if (gammaBound != nullptr) {
+        std::copy(gammaBound, gammaBound + bound.size(), boundStrengths.begin());
+    }
+
+    if (nLines == 0) {
+        std::copy(attachLine.begin(), attachLine.end(), line(0));
+        nLines = 1;
+    }
+
+    // Free particles move with the velocity of the wake (and bound lattice)
+    // as it was shed.
+    const int n_trailing{ trailingParticles.size() };
+    const int n_shed{ shedParticles.size() };
+    if (options.particles) { convectParticles(); }
+
+    if (nRows == rowCapacity) {
+        if (bounded) { lumpOldestRow(); }
+        else { grow(); }
+    }
+
+    for (int l{ 0 }; l != nLines; l++) {
+        double* p{ line(l) };
+        for (int i{ 0 }; i != 3 * nodesPerLine; i++) { p[i] += step[i % 3]; }
+    }
+    if (options.particles)
+    {
+        // Only the particles lumped this step still need the freestream.
+        for (auto [pool, first] : { std::pair{ &trailingParticles, n_trailing }, std::pair{ &shedParticles, n_shed } }) {
+            for (int k{ first }; k < pool->size(); k++) {
+                pool->x[k] += step[0]; pool->y[k] += step[1]; pool->z[k] += step[2];
+            }
+        }
+    }
+    else
+    {
+        trailingParticles.translate(step[0], step[1], step[2]);
+        shedParticles.translate(step[0], step[1], step[2]);
+    }
+
+    std::copy(attachLine.begin(), attachLine.end(), line(nLines));
+    std::copy(gammaTrailingEdge, gammaTrailingEdge + ringsPerRow, row(nRows));
+    nLines++;
+    nRows++;
+    nShed++;
+
+    double h{ options.cellSize };
+    if (h <= 0) { h = 2 * std::sqrt(step[0] * step[0] + step[1] * step[1] + step[2] * step[2]); }
+
+    const bool redistributing{ options.redistributeEvery > 0 };
+    if (redistributing && nShed % options.redistributeEvery == 0)
+    {
+        trailingParticles.redistribute(h);
+        shedParticles.redistribute(h);
+    }
+
+    // Coarsen the far wake once a pool is full. Without redistribution the
+    // pools are in shed row order, so particles merge streamwise (same edge
+    // of consecutive rows) and the spanwise loading is kept. Redistributed
+    // pools are no longer in row order, so their oldest half is regridded
+    // on ever coarser cells instead, which only merges neighbours.
+    auto coarsen = [&](utils::Particles& pool, int stride)
+    {
+        if (pool.size() <= maxParticles) { return; }
+
+        if (!redistributing) {
+            pool.mergeOldest(pool.size() / 2, stride);
+            return;
+        }
+
+        int oldest{ pool.size() / 2 };
+        for (double coarse{ 2 * h }; pool.size() > maxParticles && coarse < 1e3 * h; coarse *= 2)
+        {
+            const int before{ pool.size() };
+            pool.redistribute(coarse, oldest);
+            oldest -= before - pool.size();
+        }
+    };
+    coarsen(trailingParticles, nodesPerLine);
+    coarsen(shedParticles, ringsPerRow);
+
+    buildSegments();
+}
+
+/// <summary>
+/// Replaces the oldest near row by particles at the midpoints of the edges
+/// that leave the near wake: its rear line (net of the row lumped before it)
+/// and its chordwise edges. Particle strength is the edge's G dl. Every edge
+/// gives a particle, so each pool grows by a fixed row width per step.
+/// </summary>
+void Wake::lumpOldestRow()
+{
+    const double* rear{ line(0) };
+    const double* front{ line(1) };
+    const double* g{ row(0) };
+    const double step_length{ std::sqrt(step[0] * step[0] + step[1] * step[1] + step[2] * step[2]) };
+
+    auto lump = [&](utils::Particles& pool, const double* P1, const double* P2, double strength)
+    {
+        double mid[3];
+        double alpha[3];
+        for (int d{ 0 }; d != 3; d++) {
+            mid[d] = 0.5 * (P1[d] + P2[d]);
+            alpha[d] = strength * (P2[d] - P1[d]);
+        }
+        double length{ std::sqrt(
+            std::pow(P2[0] - P1[0], 2) + std::pow(P2[1] - P1[1], 2) + std::pow(P2[2] - P1[2], 2)) };
+
+        pool.add(mid, alpha, std::max(length, step_length));
+    };
+
+    for (int w{ 0 }; w != (int)nodeOffsets.size(); w++)
+    {
+        const int m{ wingRings(w) };
+        const int n0{ nodeOffsets[w] };
+        const int r0{ ringOffsets[w] };
+
+        for (int j{ 0 }; j != m; j++) {
+            lump(shedParticles, &rear[3 * (n0 + j)], &rear[3 * (n0 + j + 1)],
+                gammaLumped[r0 + j] - g[r0 + j]);
+        }
+        for (int j{ 0 }; j <= m; j++) {
+            double left{ j > 0 ? g[r0 + j - 1] : 0 };
+            double right{ j < m ? g[r0 + j] : 0 };
+            lump(trailingParticles, &front[3 * (n0 + j)], &rear[3 * (n0 + j)], left - right);
+        }
+    }
+
+    std::copy(g, g + ringsPerRow, gammaLumped.begin());
+    lineHead = (lineHead + 1) % (rowCapacity + 1);
+    rowHead = (rowHead + 1) % rowCapacity;
+    nLines--;
+    nRows--;
+    nLumped++;
+}
+
+/// <summary>
+/// Unique wake edges and their net strengths:
+///     spanwise edge on line l, j -> j+1:     +G(l-1,j) - G(l,j)
+///     chordwise edge in row r, front -> rear: +G(r,j-1) - G(r,j)
+/// The closing edges of the trailing edge rings (on the front line) belong
+/// to the lattice, so only the wake rows' part is held here. Behind the
+/// oldest near row, G(-1) is the last row lumped into particles.
+/// </summary>
+void Wake::buildSegments()
+{
+    const int n_wings{ (int)nodeOffsets.size() };
+
+    segments.clear();
+    strengths.clear();
+    trailingStrengths.clear();
+    segments.reserve(nLines * nodesPerLine + nRows * nodesPerLine);
+
+    for (int w{ 0 }; w != n_wings; w++)
+    {
+        const int m{ wingRings(w) };
+        const int n0{ nodeOffsets[w] };
+        const int r0{ ringOffsets[w] };
+
+        auto ring = [&](int r, int j) {
+            if (j < 0 || j >= m || r >= nRows) { return 0.0; }
+            return r < 0 ? gammaLumped[r0 + j] : row(r)[r0 + j];
+        };
+
+        for (int l{ 0 }; l != nLines; l++) {
+            double* p{ line(l) };
+            for (int j{ 0 }; j != m; j++) {
+                segments.add(&p[3 * (n0 + j)], &p[3 * (n0 + j + 1)]);
+                strengths.push_back(ring(l - 1, j) - ring(l, j));
+                trailingStrengths.push_back(0);
+            }
+        }
+
+        for (int r{ 0 }; r != nRows; r++) {
+            double* rear{ line(r) };
+            double* front{ line(r + 1) };
+            for (int j{ 0 }; j <= m; j++) {
+                segments.add(&front[3 * (n0 + j)], &rear[3 * (n0 + j)]);
+                strengths.push_back(ring(r, j - 1) - ring(r, j));
+                trailingStrengths.push_back(strengths.back());
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Velocity induced by the whole wake (rings and particles) and the bound
+/// lattice, with the mirror image about y = 0, at n targets.
+/// </summary>
+void Wake::induced(
+    const double* x, const double* y, const double* z, int n,
+    double* u, double* v, double* w
+) const
+{
+    const int S{ std::max(segments.size(), bound.size()) };
+
+    utils::parallelFor(n, [&](int first, int last)
+    {
+        const int m{ last - first };
+        std::vector<double> ym(m);
+        std::vector<double> um(m, 0), vm(m, 0), wm(m, 0);
+        for (int i{ 0 }; i != m; i++) { ym[i] = -y[first + i]; }
+
+        std::fill(u + first, u + last, 0.0);
+        std::fill(v + first, v + last, 0.0);
+        std::fill(w + first, w + last, 0.0);
+
+        for (const utils::Particles* pool : { &trailingParticles, &shedParticles })
+        {
+            utils::particleInteractions(*pool, 0, pool->size(),
+                x + first, y + first, z + first, m, u + first, v + first, w + first);
+            utils::particleInteractions(*pool, 0, pool->size(),
+                x + first, ym.data(), z + first, m, um.data(), vm.data(), wm.data());
+        }
+
+        std::vector<double> su(S), sv(S), sw(S);
+        for (int i{ 0 }; i != m; i++)
+        {
+            const int t{ first + i };
+            for (auto [lattice, gamma] : { std::pair{ &segments, &strengths }, std::pair{ &bound, &boundStrengths } })
+            {
+                if (lattice->size() == 0) { continue; }
+
+                for (double mirror : { 1.0, -1.0 })
+                {
+                    utils::lineVortices(*lattice, x[t], mirror * y[t], z[t], R, su.data(), sv.data(), sw.data());
+
+                    double qu{ 0 }, qv{ 0 }, qw{ 0 };
+                    for (int s{ 0 }; s != lattice->size(); s++) {
+                        qu += (*gamma)[s] * su[s];
+                        qv += (*gamma)[s] * sv[s];
+                        qw += (*gamma)[s] * sw[s];
+                    }
+                    if (mirror > 0) { u[t] += qu; v[t] += qv; w[t] += qw; }
+                    else { um[i] += qu; vm[i] += qv; wm[i] += qw; }
+                }
+            }
+
+            u[t] += um[i];
+            v[t] -= vm[i];
+            w[t] += wm[i];
+        }
+    }, options.nThreads, 8);
+}
+
+/// <summary>
+/// Forward Euler step of the existing particles: freestream plus the
+/// velocity induced by the wake and the bound lattice, all evaluated before
+/// any particle moves.
+/// </summary>
+void Wake::convectParticles()
+{
+    const double dt{ options.dt };
+
+    std::array<std::vector<double>, 6> velocity;
+    std::array<utils::Particles*, 2> pools{ &trailingParticles, &shedParticles };
+    for (int p{ 0 }; p != 2; p++)
+    {
+        const int n{ pools[p]->size() };
+        for (int d{ 0 }; d != 3; d++) { velocity[3 * p + d].resize(n); }
+
+        induced(pools[p]->x.data(), pools[p]->y.data(), pools[p]->z.data(), n,
+            velocity[3 * p].data(), velocity[3 * p + 1].data(), velocity[3 * p + 2].data());
+    }
+
+    for (int p{ 0 }; p != 2; p++)
+    {
+        utils::Particles& pool{ *pools[p] };
+        for (int k{ 0 }; k != pool.size(); k++) {
+            pool.x[k] += step[0] + dt * velocity[3 * p][k];
+            pool.y[k] += step[1] + dt * velocity[3 * p + 1][k];
+            pool.z[k] += step[2] + dt * velocity[3 * p + 2][k];
+        }
+    }
+}
+
+/// <summary>
+/// Points are split across threads; each point runs the vectorised segment
+/// and particle kernels over the whole wake. Cost is linear in the wake
+/// size, which is fixed for a bounded wake.
+/// </summary>
+void Wake::normalWash(
+    const std::vector<double>& points, const std::vector<double>& normals,
+    double* wash, double* downwash, int nThreads
+) const
+{
+    const int N{ (int)points.size() / 3 };
+    const int S{ segments.size() };
+    const int P{ std::max(trailingParticles.size(), shedParticles.size()) };
+
+    utils::parallelFor(N, [&](int first, int last)
+    {
+        std::vector<double> u(std::max(S, P)), v(std::max(S, P)), w(std::max(S, P));
+        std::vector<double> um(std::max(S, P)), vm(std::max(S, P)), wm(std::max(S, P));
+
+        // Normal component of the induced velocity plus its mirror image.
+        auto q_n = [&](int k, const double* n) {
+            return (u[k] + um[k]) * n[0] + (v[k] - vm[k]) * n[1] + (w[k] + wm[k]) * n[2];
+        };
+
+        for (int i{ first }; i != last; i++)
+        {
+            const double* p{ &points[3 * i] };
+            const double* n{ &normals[3 * i] };
+
+            double q_all{ 0 };
+            double q_trailing{ 0 };
+
+            if (S > 0)
+            {
+                utils::lineVortices(segments, p[0], p[1], p[2], R, u.data(), v.data(), w.data());
+                utils::lineVortices(segments, p[0], -p[1], p[2], R, um.data(), vm.data(), wm.data());
+
+                for (int s{ 0 }; s != S; s++) {
+                    double q{ q_n(s, n) };
+                    q_all += strengths[s] * q;
+                    q_trailing += trailingStrengths[s] * q;
+                }
+            }
+
+            for (const utils::Particles* pool : { &trailingParticles, &shedParticles })
+            {
+                if (pool->size() == 0) { continue; }
+
+                utils::particleVelocities(*pool, p[0], p[1], p[2], u.data(), v.data(), w.data());
+                utils::particleVelocities(*pool, p[0], -p[1], p[2], um.data(), vm.data(), wm.data());
+
+                double q{ 0 };
+                for (int k{ 0 }; k != pool->size(); k++) { q += q_n(k, n); }
+
+                q_all += q;
+                if (pool == &trailingParticles) { q_trailing += q; }
+            }
+
+            wash[i] = q_all;
+            if (downwash != nullptr) { downwash[i] = q_trailing; }
+        }
+    }, nThreads);
+}
+
+std::size_t Wake::memoryUse() const
+{
+    return (lines.size() + gamma.size() + gammaLumped.size() + 8 * (size_t)segments.size()
+        + 7 * (size_t)(trailingParticles.size() + shedParticles.size())) * sizeof(double);
+}
+
+void Wake::write(utils::ByteWriter& out) const
+{
+    out.put(nodesPerLine);
+    out.put(ringsPerRow);
+    out.put(options.particles);
+    out.put(nRows);
+    out.put(nLines);
+    out.put(nLumped);
+    out.put(nShed);
+
+    // Near wake oldest first, without the ring buffer offsets.
+    for (int l{ 0 }; l != nLines; l++) {
+        out.put(getLine(l), 3 * (size_t)nodesPerLine);
+    }
+    for (int r{ 0 }; r != nRows; r++) {
+        out.put(&gamma[(size_t)ringsPerRow * ((rowHead + r) % rowCapacity)], (size_t)ringsPerRow);
+    }
+    out.put(gammaLumped);
+
+    for (const utils::Particles* pool : { &trailingParticles, &shedParticles }) {
+        for (const std::vector<double>* v : { &pool->x, &pool->y, &pool->z, &pool->ax, &pool->ay, &pool->az, &pool->sigma }) {
+            out.put(*v);
+        }
+    }
+}
+
+void Wake::read(utils::ByteReader& in)
+{
+    if (in.get<int>() != nodesPerLine || in.get<int>() != ringsPerRow) {
+        throw std::runtime_error("Checkpoint wake does not match the trailing edges.");
+    }
+    if (in.get<bool>() != options.particles) {
+        throw std::runtime_error("Checkpoint wake model does not match.");
+    }
+
+    const int rows{ in.get<int>() };
+    const int n_lines{ in.get<int>() };
+    if (rows < 0 || n_lines < 0 || n_lines > rows + 1 || (rows > 0 && n_lines != rows + 1)) {
+        throw std::runtime_error("Checkpoint wake is corrupt.");
+    }
+    nLumped = in.get<long long>();
+    nShed = in.get<long long>();
+
+    if (rows > rowCapacity)
+    {
+        if (bounded) {
+            throw std::runtime_error("Checkpoint wake has more rows than the memory budget allows.");
+        }
+        while (rowCapacity < rows) { rowCapacity *= 2; }
+        lines.resize(3 * (size_t)nodesPerLine * (rowCapacity + 1));
+        gamma.resize((size_t)ringsPerRow * rowCapacity);
+    }
+
+    nRows = rows;
+    nLines = n_lines;
+    lineHead = 0;
+    rowHead = 0;
+
+    auto read_into = [&](double* target, size_t n) {
+        std::vector<double> v{ in.getVector<double>() };
+        if (v.size() != n) { throw std::runtime_error("Checkpoint wake is corrupt."); }
+        std::copy(v.begin(), v.end(), target);
+    };
+    for (int l{ 0 }; l != nLines; l++) {
+        read_into(line(l), 3 * (size_t)nodesPerLine);
+    }
+    for (int r{ 0 }; r != nRows; r++) {
+        read_into(row(r), (size_t)ringsPerRow);
+    }
+    read_into(gammaLumped.data(), (size_t)ringsPerRow);
+
+    for (utils::Particles* pool : { &trailingParticles, &shedParticles })
+    {
+        // Every component the length of x, else the kernels read past them.
+        for (std::vector<double>* v : { &pool->x, &pool->y, &pool->z, &pool->ax, &pool->ay, &pool->az, &pool->sigma }) {
+            *v = in.getVector<double>();
+            if (v->size() != pool->x.size()) { throw std::runtime_error("Checkpoint wake is corrupt."); }
+        }
+    }
+
+    buildSegments();
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <pch.h>
+
+#include <utils/vortex.hpp>
+#include <utils/checkpoint.hpp>
+
+/// <summary>
+/// Vortex ring wake shed from the trailing edges of a ring lattice. The
+/// wake is stored as node lines, oldest first: ring row r lies between line
+/// r (rear) and line r+1 (front), and keeps the strength of the trailing
+/// edge rings that shed it (Kelvin). Rows are convected with the
+/// freestream, so the wake is rigid in the body frame.
+///
+/// As on the lattice, each wake edge is stored once with the net strength
+/// of the rings either side of it.
+///
+/// With a memory budget the near wake is a ring buffer of a fixed number of
+/// rows. The oldest row is lumped into vortex particles when a new row is
+/// shed (one per edge, so no vorticity is lost), and once the particle pool
+/// is full its oldest half is merged pairwise. Memory and the cost of
+/// normalWash then stay constant however long the run.
+///
+/// The particle model keeps only the row at the trailing edge as rings.
+/// Older rows become particles that convect freely with the freestream plus
+/// the velocity the wake and bound lattice (setBoundLattice) induce on them
+/// (forward Euler, no stretching), optionally redistributed onto a grid
+/// every few steps. Without a memory budget the particle pools are capped
+/// at 16 rows' worth of particles, merging as a bounded wake does.
+/// </summary>
+class Wake {
+public:
+    struct Options {
+        std::size_t memoryBudget{ 0 };  // bytes (0: unbounded rings, capped particles)
+        bool particles{ false };        // particle model
+        double dt{ 0 };                 // particle model time step
+        int redistributeEvery{ 0 };     // steps (0: never)
+        double cellSize{ 0 };           // redistribution grid (0: 2 |step|)
+        int nThreads{ 0 };              // particle convection
+    };
+
+private:
+    // Initial ring rows of an unbounded wake, and particle rows of a
+    // particle wake without a budget.
+    static constexpr int defaultRows{ 16 };
+
+    Options options;
+
+    std::vector<int> nodeOffsets;   // first node of each wing in a line
+    std::vector<int> ringOffsets;   // first ring of each wing in a row
+    int nodesPerLine{ 0 };
+    int ringsPerRow{ 0 };
+    std::array<double, 3> step;     // convection per time step
+    double R;
+
+    std::vector<double> attachLine; // line the next row is shed from
+
+    // Near wake ring buffers. Line l (0 = oldest) is in slot
+    // (lineHead + l) % (rowCapacity + 1), row r in (rowHead + r) % rowCapacity.
+    int rowCapacity{ 0 };
+    bool bounded{ false };
+    int nRows{ 0 };
+    int nLines{ 0 };
+    int lineHead{ 0 };
+    int rowHead{ 0 };
+    std::vector<double> lines;
+    std::vector<double> gamma;
+    std::vector<double> gammaLumped;    // last row lumped into particles
+
+    // Far wake - particles from chordwise (trailing) and spanwise edges.
+    utils::Particles trailingParticles;
+    utils::Particles shedParticles;
+    int maxParticles{ 0 };              // per pool
+    long long nLumped{ 0 };
+    long long nShed{ 0 };
+
+    // Bound lattice (body frame) and its strengths at the last shed step,
+    // for particle convection.
+    utils::Segments bound;
+    std::vector<double> boundStrengths;
+
+    utils::Segments segments;
+    std::vector<double> strengths;
+    std::vector<double> trailingStrengths; // chordwise edges only, else 0
+
+    double* line(int l) {
+        return &lines[3 * (size_t)nodesPerLine * ((lineHead + l) % (rowCapacity + 1))];
+    }
+    double* row(int r) {
+        return &gamma[(size_t)ringsPerRow * ((rowHead + r) % rowCapacity)];
+    }
+    int wingRings(int w) const {
+        return (w + 1 < (int)ringOffsets.size() ? ringOffsets[w + 1] : ringsPerRow) - ringOffsets[w];
+    }
+
+    void grow();
+    void lumpOldestRow();
+    void buildSegments();
+    void induced(
+        const double* x, const double* y, const double* z, int n,
+        double* u, double* v, double* w
+    ) const;
+    void convectParticles();
+
+public:
+    /// <param name="trailingEdges">Trailing edge node row of each wing
+    /// ((m+1) x 3).</param>
+    /// <param name="step">Wake convection per time step (V dt).</param>
+    Wake(
+        const std::vector<std::vector<double>>& trailingEdges,
+        std::array<double, 3> step, double R, Options options
+    );
+    Wake(
+        const std::vector<std::vector<double>>& trailingEdges,
+        std::array<double, 3> step, double R = 1e-10
+    ) : Wake(trailingEdges, step, R, Options{}) {}
+
+    // Bound lattice segments whose velocity also convects free particles.
+    // Their strengths are passed to shed.
+    void setBoundLattice(const utils::Segments& segments);
+
+    // Convects the wake one step and sheds a row with the trailing edge
+    // ring strengths (ringsPerRow, wing by wing). gammaBound: strengths of
+    // the setBoundLattice segments this step (else the last ones given).
+    void shed(const double* gammaTrailingEdge, const double* gammaBound = nullptr);
+
+    // Normal velocity induced at each point (3N points and normals), with
+    // the mirror image about y = 0. downwash (optional) receives the part
+    // induced by the trailing (chordwise) edges, used for induced drag.
+    void normalWash(
+        const std::vector<double>& points, const std::vector<double>& normals,
+        double* wash, double* downwash = nullptr, int nThreads = 0
+    ) const;
+
+    // Full wake state, for checkpoints. read expects a wake built with the
+    // same trailing edges and model; an unbounded wake grows to fit.
+    void write(utils::ByteWriter& out) const;
+    void read(utils::ByteReader& in);
+
+    int rows() const { return nRows; }     // near wake rows
+    int width() const { return ringsPerRow; }
+    int size() const { return segments.size(); }
+    int particles() const { return trailingParticles.size() + shedParticles.size(); }
+    const utils::Particles& getTrailingParticles() const { return trailingParticles; }
+    const utils::Particles& getShedParticles() const { return shedParticles; }
+    long long lumpedRows() const { return nLumped; }
+    std::size_t memoryUse() const;
+
+    // Near wake line l ((nodesPerLine) x 3), l = 0 oldest.
+    const double* getLine(int l) const {
+        return &lines[3 * (size_t)nodesPerLine * ((lineHead + l) % (rowCapacity + 1))];
+    }
+    int getNodesPerLine() const { return nodesPerLine; }
+
+};